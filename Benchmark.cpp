@@ -0,0 +1,178 @@
+#include "Benchmark.h"
+#include "ORAMTree.h"
+#include "RingORAM.h"
+#include "BucketCipher.h"
+#include "Random.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+template <int Z, int Arity>
+static void benchmarkGeometry(int numBlocks, int numQueries, unsigned seed)
+{
+    using Tree = BasicORAMTree<Z, Arity>;
+    std::mt19937 g(seed);
+
+    // One leaf per block, as in Path ORAM
+    int depth = Tree::Geometry::depthForLeaves(std::max(1, numBlocks));
+    Tree tree(depth);
+    std::uniform_int_distribution<LeafId> leafDist(0, tree.getLeafCount() - 1);
+
+    // Place every block in the deepest non-full bucket on its path
+    int overflow = 0;
+    for (int id = 0; id < numBlocks; ++id) {
+        std::vector<NodeIndex> path = tree.getPathIndices(leafDist(g));
+        bool placed = false;
+        for (auto it = path.rbegin(); it != path.rend() && !placed; ++it) {
+            placed = tree.addBlock(*it, Block(id, "bench", false));
+        }
+        if (!placed) ++overflow;
+    }
+
+    long long bucketsRead = 0;
+    long long blocksRead = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int q = 0; q < numQueries; ++q) {
+        for (NodeIndex idx : tree.getPathIndices(leafDist(g))) {
+            TreeNode node = tree.getNode(idx);
+            ++bucketsRead;
+            blocksRead += static_cast<long long>(node.bucket.size());
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::micro> elapsed = end - start;
+
+    std::cout << "  Z=" << Z << " arity=" << std::setw(2) << Arity
+              << " | depth " << std::setw(2) << depth
+              << " | buckets/query " << std::setw(5) << static_cast<double>(bucketsRead) / numQueries
+              << " | slots/query " << std::setw(5) << static_cast<double>(bucketsRead) * Z / numQueries
+              << " | real blocks/query " << std::setw(7) << static_cast<double>(blocksRead) / numQueries
+              << " | " << std::setw(8) << elapsed.count() / numQueries << " us/query"
+              << " | overflow " << overflow << "\n";
+}
+
+void benchmarkGeometries(int numBlocks, int numQueries)
+{
+    if (numBlocks < 1 || numQueries < 1) {
+        std::cerr << "Error: Number of blocks and queries must both be >= 1.\n";
+        return;
+    }
+
+    // The binary tree is the deepest of the three, and all of them are allocated densely
+    if (TreeGeometry<2>::depthForLeaves(numBlocks) > kMaxDenseDepth) {
+        std::cerr << "Error: At most " << TreeGeometry<2>::leafCount(kMaxDenseDepth)
+                  << " blocks, dense trees are limited to depth " << kMaxDenseDepth << ".\n";
+        return;
+    }
+
+    unsigned seed = static_cast<unsigned>(randomEngine()()); // same block placement and query stream for every geometry
+
+    std::cout << "\n[Geometry Benchmark] " << numBlocks << " blocks, " << numQueries << " path reads\n";
+    benchmarkGeometry<4, 2>(numBlocks, numQueries, seed);
+    benchmarkGeometry<4, 4>(numBlocks, numQueries, seed);
+    benchmarkGeometry<4, 8>(numBlocks, numQueries, seed);
+}
+
+void benchmarkAccessEngines(int numBlocks, int numQueries, int Z, int S, int A)
+{
+    if (numBlocks < 1 || numQueries < 1 || Z < 1 || S < 1 || A < 1) {
+        std::cerr << "Error: Blocks, queries, Z, S and A must all be >= 1.\n";
+        return;
+    }
+
+    int depth = TreeGeometry<2>::depthForLeaves(std::max(1, numBlocks));
+    if (depth > RingORAM::kMaxDepth) {
+        std::cerr << "Error: Ring ORAM is limited to depth " << RingORAM::kMaxDepth << " ("
+                  << TreeGeometry<2>::leafCount(RingORAM::kMaxDepth) << " blocks).\n";
+        return;
+    }
+    PositionMap positionMap;
+    Stash stash;
+    RingORAM ring(depth, positionMap, stash, RingPolicy{Z, S, A});
+
+    std::uniform_int_distribution<LeafId> leafDist(0, ring.getLeafCount() - 1);
+    for (int id = 0; id < numBlocks; ++id) {
+        ring.writeBlock(id, "bench", leafDist(randomEngine()));
+    }
+
+    std::uniform_int_distribution<int> blockDist(0, numBlocks - 1);
+    auto start = std::chrono::high_resolution_clock::now();
+    int misses = 0;
+    for (int q = 0; q < numQueries; ++q) {
+        if (ring.access(blockDist(randomEngine())).id == -1) ++misses;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::micro> elapsed = end - start;
+
+    double pathOnline = static_cast<double>(Z) * (depth + 1);
+    double ringOnline = static_cast<double>(ring.getOnlineBlockReads()) / numQueries;
+    double ringOffline = static_cast<double>(ring.getOfflineBlockTraffic()) / numQueries;
+
+    std::cout << "\n[Access Engine Benchmark] " << numBlocks << " blocks, " << numQueries
+              << " reads, depth " << depth << ", Z=" << Z << " S=" << S << " A=" << A << "\n";
+    std::cout << "  Path ORAM online blocks/query: " << pathOnline << "\n";
+    std::cout << "  Ring ORAM online blocks/query: " << ringOnline
+              << " (" << std::setprecision(3) << pathOnline / ringOnline << "x fewer)\n" << std::setprecision(6);
+    std::cout << "  Ring ORAM eviction/reshuffle blocks/query: " << ringOffline << "\n";
+    std::cout << "  Ring ORAM stash peak: " << stash.getHighWaterMark() << " blocks, "
+              << elapsed.count() / numQueries << " us/query, " << misses << " missed reads\n";
+    ring.printStats();
+}
+
+void benchmarkBucketCrypto(int pathLength, int blocksPerBucket, int blockBytes, int numPaths)
+{
+    if (pathLength < 1 || blocksPerBucket < 0 || blockBytes < 0 || numPaths < 1) {
+        std::cerr << "Error: Invalid bucket crypto benchmark parameters.\n";
+        return;
+    }
+
+    BucketCipher cipher(BucketCipher::generateKey());
+
+    std::vector<NodeIndex> indices(pathLength);
+    std::vector<std::vector<Block>> path(pathLength);
+    for (int level = 0; level < pathLength; ++level) {
+        indices[level] = level;
+        for (int b = 0; b < blocksPerBucket; ++b) {
+            path[level].emplace_back(level * blocksPerBucket + b, std::string(blockBytes, 'x'), false);
+        }
+    }
+    double pathMB = static_cast<double>(pathLength) * blocksPerBucket * blockBytes / (1024.0 * 1024.0);
+
+    auto run = [&](const char* label, bool batched) {
+        std::vector<SealedBucket> sealed;
+        std::vector<std::vector<Block>> opened;
+        double sealUs = 0, openUs = 0;
+        for (int p = 0; p < numPaths; ++p) {
+            auto start = std::chrono::high_resolution_clock::now();
+            if (batched) {
+                sealed = cipher.sealBatch(indices, path);
+            } else {
+                sealed.clear();
+                for (int level = 0; level < pathLength; ++level) sealed.push_back(cipher.seal(indices[level], path[level]));
+            }
+            auto mid = std::chrono::high_resolution_clock::now();
+            if (batched) {
+                cipher.openBatch(indices, sealed, opened);
+            } else {
+                opened.assign(pathLength, {});
+                for (int level = 0; level < pathLength; ++level) cipher.open(indices[level], sealed[level], opened[level]);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            sealUs += std::chrono::duration<double, std::micro>(mid - start).count();
+            openUs += std::chrono::duration<double, std::micro>(end - mid).count();
+        }
+        std::cout << "  " << label << " | seal " << std::setw(9) << sealUs / numPaths << " us/path ("
+                  << std::setw(7) << pathMB * numPaths / (sealUs / 1e6) << " MB/s)"
+                  << " | open " << std::setw(9) << openUs / numPaths << " us/path ("
+                  << std::setw(7) << pathMB * numPaths / (openUs / 1e6) << " MB/s)\n";
+    };
+
+    std::cout << "\n[Bucket Crypto Benchmark] ChaCha20-Poly1305, " << pathLength << " buckets x "
+              << blocksPerBucket << " blocks x " << blockBytes << " B per path, "
+              << std::thread::hardware_concurrency() << " hardware thread(s)\n";
+    run("per bucket", false);
+    run("per path  ", true);
+}
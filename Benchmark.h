@@ -0,0 +1,13 @@
+#pragma once
+
+// Benchmark driver: fills trees of different compile-time geometries with the same
+// number of blocks and compares the cost of random path reads on each of them.
+void benchmarkGeometries(int numBlocks, int numQueries);
+
+// Online and eviction bandwidth of Ring ORAM (Z real + S dummy slots, one eviction every A
+// accesses) against the Z * (depth + 1) blocks a Path ORAM read fetches on the same tree.
+void benchmarkAccessEngines(int numBlocks, int numQueries, int Z, int S, int A);
+
+// Throughput of sealing and opening whole paths of buckets with BucketCipher, one bucket per call
+// vs. one batch per path, for sizing the crypto share of a query.
+void benchmarkBucketCrypto(int pathLength, int blocksPerBucket, int blockBytes, int numPaths);
@@ -0,0 +1,369 @@
+#include "BucketCipher.h"
+#include "Serialization.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <thread>
+#ifdef __linux__
+#include <sys/random.h>
+#endif
+
+namespace {
+
+// Four 32-bit lanes; GCC and Clang lower this to SSE2 / NEON registers
+typedef std::uint32_t Lanes __attribute__((vector_size(16)));
+constexpr int kLanes = 4;
+constexpr std::size_t kChunkBytes = 64 * kLanes;
+
+std::uint32_t load32(const std::uint8_t* p) {
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+           (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+void store32(std::uint8_t* p, std::uint32_t v) {
+    p[0] = static_cast<std::uint8_t>(v);
+    p[1] = static_cast<std::uint8_t>(v >> 8);
+    p[2] = static_cast<std::uint8_t>(v >> 16);
+    p[3] = static_cast<std::uint8_t>(v >> 24);
+}
+
+void store64(std::uint8_t* p, std::uint64_t v) {
+    store32(p, static_cast<std::uint32_t>(v));
+    store32(p + 4, static_cast<std::uint32_t>(v >> 32));
+}
+
+Lanes rotl(Lanes v, int n) { return (v << n) | (v >> (32 - n)); }
+
+void quarterRound(Lanes& a, Lanes& b, Lanes& c, Lanes& d) {
+    a += b; d ^= a; d = rotl(d, 16);
+    c += d; b ^= c; b = rotl(b, 12);
+    a += b; d ^= a; d = rotl(d, 8);
+    c += d; b ^= c; b = rotl(b, 7);
+}
+
+struct ChaChaState {
+    std::uint32_t words[16];
+
+    ChaChaState(const BucketKey& key, const std::uint8_t nonce[12]) {
+        words[0] = 0x61707865; words[1] = 0x3320646e; words[2] = 0x79622d32; words[3] = 0x6b206574;
+        for (int i = 0; i < 8; ++i) words[4 + i] = load32(key.data() + 4 * i);
+        words[12] = 0;
+        for (int i = 0; i < 3; ++i) words[13 + i] = load32(nonce + 4 * i);
+    }
+
+    // Keystream blocks counter .. counter + 3, one per lane
+    void keystream(std::uint32_t counter, std::uint8_t out[kChunkBytes]) const {
+        Lanes in[16], x[16];
+        for (int i = 0; i < 16; ++i) in[i] = Lanes{} + words[i];
+        in[12] = Lanes{counter, counter + 1, counter + 2, counter + 3};
+        for (int i = 0; i < 16; ++i) x[i] = in[i];
+
+        for (int round = 0; round < 10; ++round) {
+            quarterRound(x[0], x[4], x[8], x[12]);
+            quarterRound(x[1], x[5], x[9], x[13]);
+            quarterRound(x[2], x[6], x[10], x[14]);
+            quarterRound(x[3], x[7], x[11], x[15]);
+            quarterRound(x[0], x[5], x[10], x[15]);
+            quarterRound(x[1], x[6], x[11], x[12]);
+            quarterRound(x[2], x[7], x[8], x[13]);
+            quarterRound(x[3], x[4], x[9], x[14]);
+        }
+
+        // Transpose word-major lanes into four consecutive 64-byte blocks
+        std::uint32_t words[16][kLanes];
+        for (int i = 0; i < 16; ++i) {
+            x[i] += in[i];
+            std::memcpy(words[i], &x[i], sizeof(Lanes));
+        }
+        for (int lane = 0; lane < kLanes; ++lane) {
+            for (int i = 0; i < 16; ++i) store32(out + 64 * lane + 4 * i, words[i][lane]);
+        }
+    }
+
+    // XORs the keystream starting at block 1 into data (block 0 keys Poly1305)
+    void apply(std::uint8_t* data, std::size_t len) const {
+        std::uint8_t stream[kChunkBytes];
+        for (std::size_t offset = 0; offset < len; offset += kChunkBytes) {
+            keystream(static_cast<std::uint32_t>(1 + offset / 64), stream);
+            std::size_t n = std::min(kChunkBytes, len - offset);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                std::uint64_t d, k;
+                std::memcpy(&d, data + offset + i, 8);
+                std::memcpy(&k, stream + i, 8);
+                d ^= k;
+                std::memcpy(data + offset + i, &d, 8);
+            }
+            for (; i < n; ++i) data[offset + i] ^= stream[i];
+        }
+    }
+};
+
+// Poly1305 over 26-bit limbs. The AEAD construction pads every input to 16 bytes, so only
+// full blocks are ever absorbed.
+class Poly1305 {
+private:
+    std::uint32_t r[5];
+    std::uint32_t h[5] = {0, 0, 0, 0, 0};
+    std::uint32_t pad[4];
+
+public:
+    explicit Poly1305(const std::uint8_t key[32]) {
+        r[0] = load32(key + 0) & 0x3ffffff;
+        r[1] = (load32(key + 3) >> 2) & 0x3ffff03;
+        r[2] = (load32(key + 6) >> 4) & 0x3ffc0ff;
+        r[3] = (load32(key + 9) >> 6) & 0x3f03fff;
+        r[4] = (load32(key + 12) >> 8) & 0x00fffff;
+        for (int i = 0; i < 4; ++i) pad[i] = load32(key + 16 + 4 * i);
+    }
+
+    void block(const std::uint8_t m[16]) {
+        const std::uint32_t mask = 0x3ffffff;
+        std::uint64_t s1 = r[1] * 5ull, s2 = r[2] * 5ull, s3 = r[3] * 5ull, s4 = r[4] * 5ull;
+
+        std::uint64_t h0 = h[0] + (load32(m + 0) & mask);
+        std::uint64_t h1 = h[1] + ((load32(m + 3) >> 2) & mask);
+        std::uint64_t h2 = h[2] + ((load32(m + 6) >> 4) & mask);
+        std::uint64_t h3 = h[3] + ((load32(m + 9) >> 6) & mask);
+        std::uint64_t h4 = h[4] + ((load32(m + 12) >> 8) | (1u << 24));
+
+        std::uint64_t d0 = h0 * r[0] + h1 * s4 + h2 * s3 + h3 * s2 + h4 * s1;
+        std::uint64_t d1 = h0 * r[1] + h1 * r[0] + h2 * s4 + h3 * s3 + h4 * s2;
+        std::uint64_t d2 = h0 * r[2] + h1 * r[1] + h2 * r[0] + h3 * s4 + h4 * s3;
+        std::uint64_t d3 = h0 * r[3] + h1 * r[2] + h2 * r[1] + h3 * r[0] + h4 * s4;
+        std::uint64_t d4 = h0 * r[4] + h1 * r[3] + h2 * r[2] + h3 * r[1] + h4 * r[0];
+
+        std::uint64_t c = d0 >> 26; h[0] = d0 & mask;
+        d1 += c; c = d1 >> 26; h[1] = d1 & mask;
+        d2 += c; c = d2 >> 26; h[2] = d2 & mask;
+        d3 += c; c = d3 >> 26; h[3] = d3 & mask;
+        d4 += c; c = d4 >> 26; h[4] = d4 & mask;
+        h[0] += static_cast<std::uint32_t>(c * 5);
+        h[1] += h[0] >> 26; h[0] &= mask;
+    }
+
+    // Absorbs data followed by zero padding up to a multiple of 16 bytes
+    void padded(const std::uint8_t* data, std::size_t len) {
+        std::size_t full = len / 16 * 16;
+        for (std::size_t i = 0; i < full; i += 16) block(data + i);
+        if (full < len) {
+            std::uint8_t last[16] = {0};
+            std::memcpy(last, data + full, len - full);
+            block(last);
+        }
+    }
+
+    void finish(std::uint8_t tag[16]) {
+        const std::uint32_t mask = 0x3ffffff;
+        std::uint32_t c;
+        c = h[1] >> 26; h[1] &= mask; h[2] += c;
+        c = h[2] >> 26; h[2] &= mask; h[3] += c;
+        c = h[3] >> 26; h[3] &= mask; h[4] += c;
+        c = h[4] >> 26; h[4] &= mask; h[0] += c * 5;
+        c = h[0] >> 26; h[0] &= mask; h[1] += c;
+
+        // h - p, kept only if it does not underflow
+        std::uint32_t g[5];
+        g[0] = h[0] + 5; c = g[0] >> 26; g[0] &= mask;
+        g[1] = h[1] + c; c = g[1] >> 26; g[1] &= mask;
+        g[2] = h[2] + c; c = g[2] >> 26; g[2] &= mask;
+        g[3] = h[3] + c; c = g[3] >> 26; g[3] &= mask;
+        g[4] = h[4] + c - (1u << 26);
+
+        std::uint32_t select = (g[4] >> 31) - 1;
+        for (int i = 0; i < 5; ++i) h[i] = (h[i] & ~select) | (g[i] & select);
+
+        std::uint32_t w0 = h[0] | (h[1] << 26);
+        std::uint32_t w1 = (h[1] >> 6) | (h[2] << 20);
+        std::uint32_t w2 = (h[2] >> 12) | (h[3] << 14);
+        std::uint32_t w3 = (h[3] >> 18) | (h[4] << 8);
+
+        std::uint64_t f = static_cast<std::uint64_t>(w0) + pad[0];
+        store32(tag + 0, static_cast<std::uint32_t>(f));
+        f = static_cast<std::uint64_t>(w1) + pad[1] + (f >> 32);
+        store32(tag + 4, static_cast<std::uint32_t>(f));
+        f = static_cast<std::uint64_t>(w2) + pad[2] + (f >> 32);
+        store32(tag + 8, static_cast<std::uint32_t>(f));
+        f = static_cast<std::uint64_t>(w3) + pad[3] + (f >> 32);
+        store32(tag + 12, static_cast<std::uint32_t>(f));
+    }
+};
+
+// RFC 8439 section 2.8 tag over aad || ciphertext
+void computeTag(const ChaChaState& state, const std::uint8_t* aad, std::size_t aadLen,
+                const std::uint8_t* ciphertext, std::size_t len, std::uint8_t tag[16]) {
+    std::uint8_t block0[kChunkBytes];
+    state.keystream(0, block0);
+
+    Poly1305 mac(block0);
+    mac.padded(aad, aadLen);
+    mac.padded(ciphertext, len);
+    std::uint8_t lengths[16];
+    store64(lengths, aadLen);
+    store64(lengths + 8, len);
+    mac.block(lengths);
+    mac.finish(tag);
+}
+
+// Encrypts data in place and writes its tag
+void sealInPlace(const BucketKey& key, const std::uint8_t nonce[12], const std::uint8_t* aad, std::size_t aadLen,
+                 std::uint8_t* data, std::size_t len, std::uint8_t tag[16]) {
+    ChaChaState state(key, nonce);
+    state.apply(data, len);
+    computeTag(state, aad, aadLen, data, len, tag);
+}
+
+// Checks the tag in constant time and only then decrypts data in place
+bool openInPlace(const BucketKey& key, const std::uint8_t nonce[12], const std::uint8_t* aad, std::size_t aadLen,
+                 std::uint8_t* data, std::size_t len, const std::uint8_t expected[16]) {
+    ChaChaState state(key, nonce);
+    std::uint8_t tag[16];
+    computeTag(state, aad, aadLen, data, len, tag);
+    std::uint8_t diff = 0;
+    for (int b = 0; b < 16; ++b) diff |= tag[b] ^ expected[b];
+    if (diff != 0) return false;
+
+    state.apply(data, len);
+    return true;
+}
+
+void makeNonce(std::uint64_t counter, std::uint8_t nonce[12]) {
+    store32(nonce, 0);
+    store64(nonce + 4, counter);
+}
+
+void makeAad(NodeIndex index, std::uint8_t aad[8]) {
+    store64(aad, static_cast<std::uint64_t>(index));
+}
+
+// Runs work(i) for every i, on several threads when the batch is big enough to pay for them
+template <typename Work>
+void runBatch(std::size_t count, std::size_t totalBytes, std::size_t parallelBytes, Work work) {
+    std::size_t threads = std::min<std::size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+    if (totalBytes < parallelBytes || threads < 2) {
+        for (std::size_t i = 0; i < count; ++i) work(i);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (std::size_t i = t; i < count; i += threads) work(i);
+        });
+    }
+    for (auto& w : workers) w.join();
+}
+
+} // namespace
+
+BucketCipher::BucketCipher(const BucketKey& key) : key(key) {}
+
+BucketKey BucketCipher::generateKey() {
+    BucketKey key;
+#ifdef __linux__
+    std::size_t filled = 0;
+    while (filled < key.size()) {
+        ssize_t n = getrandom(key.data() + filled, key.size() - filled, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        filled += static_cast<std::size_t>(n);
+    }
+    if (filled == key.size()) return key;
+#endif
+    std::random_device device;
+    for (std::size_t i = 0; i < key.size(); i += 4) {
+        std::uint32_t word = device();
+        std::memcpy(key.data() + i, &word, 4);
+    }
+    return key;
+}
+
+void BucketCipher::sealBytes(const BucketKey& key, const std::uint8_t nonce[12], const std::vector<std::uint8_t>& aad,
+                             std::vector<std::uint8_t>& data, std::array<std::uint8_t, 16>& tag) {
+    sealInPlace(key, nonce, aad.data(), aad.size(), data.data(), data.size(), tag.data());
+}
+
+bool BucketCipher::openBytes(const BucketKey& key, const std::uint8_t nonce[12], const std::vector<std::uint8_t>& aad,
+                             std::vector<std::uint8_t>& data, const std::array<std::uint8_t, 16>& tag) {
+    return openInPlace(key, nonce, aad.data(), aad.size(), data.data(), data.size(), tag.data());
+}
+
+SealedBucket BucketCipher::seal(NodeIndex index, const std::vector<Block>& blocks) {
+    return sealBatch({index}, {blocks}).front();
+}
+
+bool BucketCipher::open(NodeIndex index, const SealedBucket& sealed, std::vector<Block>& blocks) const {
+    std::vector<std::vector<Block>> out;
+    bool ok = openBatch({index}, {sealed}, out);
+    blocks = std::move(out.front());
+    return ok;
+}
+
+std::vector<SealedBucket> BucketCipher::sealBatch(const std::vector<NodeIndex>& indices,
+                                                  const std::vector<std::vector<Block>>& buckets) {
+    std::vector<SealedBucket> sealed(buckets.size());
+    std::size_t totalBytes = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        std::ostringstream plain;
+        writeBlocks(plain, buckets[i]);
+        std::string bytes = plain.str();
+        sealed[i].ciphertext.assign(bytes.begin(), bytes.end());
+        sealed[i].nonce = nextNonce.fetch_add(1);
+        totalBytes += bytes.size();
+    }
+
+    runBatch(sealed.size(), totalBytes, kParallelBatchBytes, [&](std::size_t i) {
+        std::uint8_t nonce[12], aad[8];
+        makeNonce(sealed[i].nonce, nonce);
+        makeAad(indices[i], aad);
+
+        sealInPlace(key, nonce, aad, sizeof(aad), sealed[i].ciphertext.data(), sealed[i].ciphertext.size(),
+                    sealed[i].tag.data());
+    });
+    return sealed;
+}
+
+bool BucketCipher::openBatch(const std::vector<NodeIndex>& indices, const std::vector<SealedBucket>& sealed,
+                             std::vector<std::vector<Block>>& buckets) const {
+    buckets.assign(sealed.size(), {});
+    std::vector<std::string> plain(sealed.size());
+    std::vector<char> ok(sealed.size(), 1);
+    std::size_t totalBytes = 0;
+    for (const SealedBucket& s : sealed) totalBytes += s.ciphertext.size();
+
+    runBatch(sealed.size(), totalBytes, kParallelBatchBytes, [&](std::size_t i) {
+        if (sealed[i].isBlank()) {
+            ok[i] = 0; // nothing seals under nonce 0: the bucket was wiped or never written
+            return;
+        }
+
+        std::uint8_t nonce[12], aad[8];
+        makeNonce(sealed[i].nonce, nonce);
+        makeAad(indices[i], aad);
+
+        plain[i].assign(sealed[i].ciphertext.begin(), sealed[i].ciphertext.end());
+        if (!openInPlace(key, nonce, aad, sizeof(aad), reinterpret_cast<std::uint8_t*>(&plain[i][0]),
+                         plain[i].size(), sealed[i].tag.data())) {
+            ok[i] = 0;
+            plain[i].clear();
+        }
+    });
+
+    bool allOk = true;
+    for (std::size_t i = 0; i < sealed.size(); ++i) {
+        if (!ok[i]) {
+            allOk = false;
+            continue;
+        }
+        std::istringstream in(plain[i]);
+        if (!readBlocks(in, buckets[i])) {
+            buckets[i].clear();
+            allOk = false;
+        }
+    }
+    return allOk;
+}
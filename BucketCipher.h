@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Block.h"
+#include "TreeGeometry.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using BucketKey = std::array<std::uint8_t, 32>;
+
+// A bucket as the server stores it: the ChaCha20-Poly1305 (RFC 8439) ciphertext of the
+// serialized blocks, authenticated together with its node index so buckets cannot be swapped.
+// nonce 0 marks a bucket that was never sealed; it never opens, so wiping a bucket is caught.
+struct SealedBucket {
+    std::uint64_t nonce = 0;
+    std::vector<std::uint8_t> ciphertext;
+    std::array<std::uint8_t, 16> tag{};
+
+    bool isBlank() const { return nonce == 0; }
+};
+
+// Seals and opens buckets under one key. Keystream is generated four ChaCha20 blocks at a time
+// in SIMD lanes; batch calls handle a whole path at once and split large batches across threads.
+class BucketCipher {
+private:
+    BucketKey key;
+    std::atomic<std::uint64_t> nextNonce{1}; // never reused under this key
+
+    // Batches with at least this much plaintext are spread over hardware threads
+    static constexpr std::size_t kParallelBatchBytes = 64 * 1024;
+
+public:
+    explicit BucketCipher(const BucketKey& key);
+
+    // A fresh key from the OS (getrandom, else std::random_device), never from randomEngine():
+    // nonces restart at 1 in every process, so a key repeated by --seed would repeat them too
+    static BucketKey generateKey();
+
+    // The RFC 8439 AEAD the buckets are sealed with, over raw bytes, e.g. for known-answer tests.
+    // openBytes leaves data untouched and returns false if the tag does not match.
+    static void sealBytes(const BucketKey& key, const std::uint8_t nonce[12], const std::vector<std::uint8_t>& aad,
+                          std::vector<std::uint8_t>& data, std::array<std::uint8_t, 16>& tag);
+    static bool openBytes(const BucketKey& key, const std::uint8_t nonce[12], const std::vector<std::uint8_t>& aad,
+                          std::vector<std::uint8_t>& data, const std::array<std::uint8_t, 16>& tag);
+
+    SealedBucket seal(NodeIndex index, const std::vector<Block>& blocks);
+    bool open(NodeIndex index, const SealedBucket& sealed, std::vector<Block>& blocks) const; // false if tampered
+
+    std::vector<SealedBucket> sealBatch(const std::vector<NodeIndex>& indices,
+                                        const std::vector<std::vector<Block>>& buckets);
+    // Opens every bucket it can; false if any of them failed authentication or was blank (those come
+    // back empty)
+    bool openBatch(const std::vector<NodeIndex>& indices, const std::vector<SealedBucket>& sealed,
+                   std::vector<std::vector<Block>>& buckets) const;
+};
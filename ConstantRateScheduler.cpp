@@ -0,0 +1,154 @@
+#include "ConstantRateScheduler.h"
+#include "ORAMQuery.h"
+#include <algorithm>
+#include <iostream>
+
+ConstantRateScheduler::ConstantRateScheduler(ORAMTree& tree, PositionMap& positionMap, Stash& stash,
+                                             DRLogSet& drl, QueryLog& qlog, ConstantRatePolicy policy,
+                                             RingORAM* ring)
+    : tree(tree), positionMap(positionMap), stash(stash), drl(drl), qlog(qlog), ring(ring), policy(policy),
+      previousQueryLogC(qlog.getRoundSize()), previousDrlC(drl.getRoundSize())
+{
+    // Rounds from here on are exactly one tick: close whatever was open and size them to the width
+    sealOpenRound();
+    drl.setRoundSize(policy.roundWidth, qlog.setRoundSize(policy.roundWidth));
+
+    for (int slot = 0; slot < policy.roundWidth; ++slot) {
+        slotWorkers.emplace_back(&ConstantRateScheduler::slotLoop, this, slot);
+    }
+    dispatcher = std::thread(&ConstantRateScheduler::dispatchLoop, this);
+}
+
+ConstantRateScheduler::~ConstantRateScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    stopCv.notify_one();
+    dispatcher.join();
+
+    {
+        std::lock_guard<std::mutex> lock(slotMutex);
+        slotsStopping = true;
+    }
+    slotCv.notify_all();
+    for (auto& t : slotWorkers) t.join();
+
+    drl.setRoundSize(previousDrlC, qlog.setRoundSize(previousQueryLogC));
+}
+
+void ConstantRateScheduler::sealOpenRound() {
+    auto active = qlog.enterQuery();
+    long long drained = -1;
+    qlog.sealOpenRound(0, drained);
+    if (drained >= 0) drl.finalizeRound(drained);
+}
+
+std::future<Block> ConstantRateScheduler::submit(int blockId) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    Pending pending{blockId, Clock::now(), std::promise<Block>()};
+    std::future<Block> result = pending.result.get_future();
+    queue.push_back(std::move(pending));
+    maxQueueLength = std::max(maxQueueLength, queue.size());
+    return result;
+}
+
+void ConstantRateScheduler::dispatchLoop() {
+    auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / policy.roundsPerSecond));
+    Clock::time_point nextTick = Clock::now();
+
+    while (true) {
+        std::vector<Pending> batch;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            stopCv.wait_until(lock, nextTick, [this] { return stopping; });
+            if (stopping && queue.empty()) return;
+
+            Clock::time_point now = Clock::now();
+            while (!queue.empty() && static_cast<int>(batch.size()) < policy.roundWidth) {
+                double delayMs = std::chrono::duration<double, std::milli>(now - queue.front().enqueued).count();
+                totalQueueDelayMs += delayMs;
+                maxQueueDelayMs = std::max(maxQueueDelayMs, delayMs);
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+
+        runRound(batch);
+
+        nextTick += period;
+        if (Clock::now() > nextTick) {
+            // The round ran past its slot; start the next one now instead of bursting to catch up
+            std::lock_guard<std::mutex> lock(queueMutex);
+            ++overruns;
+            nextTick = Clock::now();
+        }
+    }
+}
+
+void ConstantRateScheduler::slotLoop(int slot) {
+    ORAMQuery query(tree, positionMap, stash, drl, qlog, ring);
+    long long seenRound = 0;
+
+    while (true) {
+        std::vector<Pending>* batch;
+        {
+            std::unique_lock<std::mutex> lock(slotMutex);
+            slotCv.wait(lock, [&] { return slotsStopping || slotRound != seenRound; });
+            if (slotsStopping) return;
+            seenRound = slotRound;
+            batch = slotBatch;
+        }
+
+        // Real and padding slots run the same query sequence; only the block ID differs
+        if (slot < static_cast<int>(batch->size())) {
+            Pending& pending = (*batch)[slot];
+            pending.result.set_value(query.read(pending.blockId));
+        } else {
+            query.dummyRead();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(slotMutex);
+            --slotsRunning;
+        }
+        slotsDoneCv.notify_one();
+    }
+}
+
+void ConstantRateScheduler::runRound(std::vector<Pending>& batch) {
+    {
+        std::unique_lock<std::mutex> lock(slotMutex);
+        slotBatch = &batch;
+        slotsRunning = policy.roundWidth;
+        ++slotRound;
+        slotCv.notify_all();
+        slotsDoneCv.wait(lock, [this] { return slotsRunning == 0; });
+    }
+
+    // The width-th registration sealed the round already; this only matters if something else
+    // registered queries in between and shifted the boundary
+    sealOpenRound();
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    ++rounds;
+    realSlots += static_cast<long long>(batch.size());
+    dummySlots += policy.roundWidth - static_cast<long long>(batch.size());
+}
+
+void ConstantRateScheduler::printStats() const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    long long slots = realSlots + dummySlots;
+
+    std::cout << "\n[Constant-Rate Scheduler] " << policy.roundsPerSecond << " rounds/s, "
+              << policy.roundWidth << " slots per round\n";
+    std::cout << "  Rounds dispatched: " << rounds << " (" << overruns << " overran their period)\n";
+    std::cout << "  Real queries: " << realSlots << ", dummy path reads: " << dummySlots << "\n";
+    if (slots > 0)
+        std::cout << "  Padding overhead: " << (100.0 * dummySlots / slots) << "% of path reads\n";
+    if (realSlots > 0)
+        std::cout << "  Queueing delay: avg " << totalQueueDelayMs / realSlots
+                  << " ms, max " << maxQueueDelayMs << " ms\n";
+    std::cout << "  Longest queue: " << maxQueueLength << " queries\n";
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ORAMTree.h"
+#include "PositionMap.h"
+#include "Stash.h"
+#include "DRLogSet.h"
+#include "QueryLog.h"
+#include "RingORAM.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ConstantRatePolicy {
+    double roundsPerSecond; // how often a round is dispatched, busy or not
+    int roundWidth;         // queries per round (slots); empty slots become dummy path reads
+};
+
+// Dispatches query rounds at a fixed rate so that server-visible timing does not follow client
+// demand. Each tick takes up to roundWidth queued queries, pads the rest of the round with dummy
+// queries and runs all slots in parallel on a pool of roundWidth slot workers; queries that do
+// not fit wait for the next tick. While it exists it owns the round boundaries: QueryLog and
+// DRLogSet rounds are set to roundWidth and every tick is exactly one round, so any
+// RoundScheduler on the same logs must be paused for that time.
+class ConstantRateScheduler {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        int blockId;
+        Clock::time_point enqueued;
+        std::promise<Block> result;
+    };
+
+    ORAMTree& tree;
+    PositionMap& positionMap;
+    Stash& stash;
+    DRLogSet& drl;
+    QueryLog& qlog;
+    RingORAM* ring; // forwarded to ORAMQuery, nullptr in Path ORAM mode
+    ConstantRatePolicy policy;
+
+    mutable std::mutex queueMutex;
+    std::condition_variable stopCv;
+    std::deque<Pending> queue;
+    bool stopping = false;
+    std::thread dispatcher;
+
+    // Slot workers, one per slot of a round and reused for every round
+    std::vector<std::thread> slotWorkers;
+    std::mutex slotMutex;
+    std::condition_variable slotCv;
+    std::condition_variable slotsDoneCv;
+    std::vector<Pending>* slotBatch = nullptr; // the round being run
+    long long slotRound = 0;                   // bumped to start a round on the workers
+    int slotsRunning = 0;
+    bool slotsStopping = false;
+
+    int previousQueryLogC; // round sizes to put back when the scheduler goes away
+    int previousDrlC;
+
+    // Metrics, guarded by queueMutex
+    long long rounds = 0;
+    long long realSlots = 0;
+    long long dummySlots = 0;
+    long long overruns = 0;       // rounds that took longer than one period
+    double totalQueueDelayMs = 0;
+    double maxQueueDelayMs = 0;
+    size_t maxQueueLength = 0;
+
+    void dispatchLoop();
+    void runRound(std::vector<Pending>& batch);
+    void slotLoop(int slot);
+    void sealOpenRound(); // closes the round in progress, if any
+
+public:
+    ConstantRateScheduler(ORAMTree& tree, PositionMap& positionMap, Stash& stash,
+                          DRLogSet& drl, QueryLog& qlog, ConstantRatePolicy policy,
+                          RingORAM* ring = nullptr);
+    ~ConstantRateScheduler(); // dispatches whatever is still queued, then stops
+
+    std::future<Block> submit(int blockId);
+    void printStats() const;
+};
@@ -1,24 +1,31 @@
 #include "DRLogSet.h"
 #include <iostream>
+#include "Serialization.h"
+#include "Random.h"
 
-DRLogSet::DRLogSet(int c) : c(c) {}
+DRLogSet::DRLogSet(int c) : roundSizes{{0, RoundSize{c}}} {}
 
-void DRLogSet::appendToCurrent(const Block& b) {
-    currentDRL.push_back(b);
+void DRLogSet::appendToCurrent(const Block& b, long long round) {
+    std::lock_guard<std::mutex> lock(drlMutex);
+    openRounds[round].push_back(b);
 }
 
 // Algorithm 1
 
 std::vector<Block> DRLogSet::readLogSet(int blockId) {  // 1st algorithm
+    std::lock_guard<std::mutex> lock(drlMutex);
     std::vector<Block> result;
 
     bool blockInCurrentDRL = false;
-    for (const Block& b : currentDRL) {
-        if (b.id == blockId) {
-            blockInCurrentDRL = true;
-            result.push_back(b); // still read from current DRL first
-            break;
+    for (const auto& [round, currentDRL] : openRounds) {
+        for (const Block& b : currentDRL) {
+            if (b.id == blockId) {
+                blockInCurrentDRL = true;
+                result.push_back(b); // still read from current DRL first
+                break;
+            }
         }
+        if (blockInCurrentDRL) break;
     }
 
 
@@ -64,20 +71,38 @@ std::vector<Block> DRLogSet::readLogSet(int blockId) {  // 1st algorithm
     return result;
 }
 
-void DRLogSet::finalizeRound() {
-    if (currentDRL.empty()) return;
+int DRLogSet::finalizeLocked(long long round) {
+    auto it = roundSizes.upper_bound(round);
+    if (it != roundSizes.begin()) --it;
+    int roundC = it->second.c;
+    ++it->second.finalized;
+
+    // Every round an entry covers has been finalized: only the entries after it still matter
+    while (roundSizes.size() > 1) {
+        auto first = roundSizes.begin();
+        auto next = std::next(first);
+        if (first->second.finalized < next->first - first->first) break;
+        roundSizes.erase(first);
+    }
+    return roundC;
+}
+
+void DRLogSet::finalizeRound(long long round) {
+    std::lock_guard<std::mutex> lock(drlMutex);
+    int roundC = finalizeLocked(round); // counted even when none of its queries wrote here
+    auto it = openRounds.find(round);
+    if (it == openRounds.end()) return;
+    const std::vector<Block>& currentDRL = it->second;
 
     std::vector<Block> log = currentDRL;
 
-    // Add c dummy blocks
-    for (int i = 0; i < c; ++i) {
+    // Add c dummy blocks, c being the round size the round was opened under
+    for (int i = 0; i < roundC; ++i) {
         log.emplace_back(-1, "", true);
     }
 
     // Shuffle the log
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(log.begin(), log.end(), g);
+    std::shuffle(log.begin(), log.end(), randomEngine());
 
     bigentryLogs.push_back(log);
 
@@ -90,69 +115,134 @@ void DRLogSet::finalizeRound() {
     }
 
     searchIndices.push_back(index);
-    currentDRL.clear();
+    openRounds.erase(it);
+
+    std::cout << "[DRL] Finalized query round and created new bigentry log.\n";
+}
+
+void DRLogSet::finalizeRound() {
+    std::vector<long long> rounds;
+    {
+        std::lock_guard<std::mutex> lock(drlMutex);
+        for (const auto& [round, currentDRL] : openRounds) rounds.push_back(round);
+    }
+    for (long long round : rounds) finalizeRound(round);
 }
 
 // Algorithm 2
 
-void DRLogSet::writeLogSet(const Block& blk, int queryId) {
+void DRLogSet::writeLogSet(const Block& blk, long long round, int queryId) {
+    std::lock_guard<std::mutex> lock(drlMutex);
 
-    currentDRL.push_back(blk); // appending the block to the current DRL
+    openRounds[round].push_back(blk); // appending the block to the current DRL
 
     // Step 2: Reshuffle the log li if it exists
     if (queryId < static_cast<int>(bigentryLogs.size())) {
         std::vector<Block>& log = bigentryLogs[queryId];  // reading the log li
 
-        std::random_device rd; // seed
-        std::mt19937 g(rd()); // random number generator with the seed rd
-        std::shuffle(log.begin(), log.end(), g); // shuffling the log li
-
-        // Optional: Print reshuffle action
-        std::cout << "[Client " << queryId << "] Reshuffled bigentry log li\n";
+        std::shuffle(log.begin(), log.end(), randomEngine()); // shuffling the log li
     }
 
-    // Step 3: Finalize round if this is the last client (queryId == c - 1)
-    if (queryId == c - 1) {
-        std::vector<Block> log = currentDRL;
+    // Step 3: the round is finalized by the last of its queries to complete (QueryLog), not here
+}
 
-        // Add c dummy blocks
-        for (int i = 0; i < c; ++i) {
-            log.emplace_back(-1, "", true);
-        }
 
-        // Shuffle combined log
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(log.begin(), log.end(), g);
+int DRLogSet::getRoundSize() const {
+    std::lock_guard<std::mutex> lock(drlMutex);
+    return roundSizes.rbegin()->second.c;
+}
+
+void DRLogSet::setRoundSize(int newC, long long fromRound) {
+    std::lock_guard<std::mutex> lock(drlMutex);
+    // A size announced for rounds after fromRound is superseded; those rounds have not opened yet
+    roundSizes.erase(roundSizes.upper_bound(fromRound), roundSizes.end());
+    if (!roundSizes.empty() && roundSizes.rbegin()->second.c == newC) return;
+    roundSizes[fromRound].c = newC;
+}
 
-        bigentryLogs.push_back(log);
+size_t DRLogSet::getFinalizedRoundCount() const {
+    std::lock_guard<std::mutex> lock(drlMutex);
+    return bigentryLogs.size();
+}
 
-        // Build search index
-        std::vector<int> index;
+void DRLogSet::printCurrentDRL() const {
+    std::lock_guard<std::mutex> lock(drlMutex);
+    std::cout << "\n[Current DR-LogSet Contents]\n";
+    if (openRounds.empty()) {
+        std::cout << "(Empty)\n";
+        return;
+    }
+
+    for (const auto& [round, currentDRL] : openRounds) {
+        std::cout << "  Round " << round << ":\n";
         for (const auto& b : currentDRL) {
-            if (!b.isDummy) {
-                index.push_back(b.id);
-            }
+            std::cout << "  [ID: " << b.id
+            << ", Data: " << b.data
+            << ", Dummy: " << (b.isDummy ? "true" : "false") << "]\n";
         }
+    }
+}
 
-        searchIndices.push_back(index);
-        currentDRL.clear();
 
-        std::cout << "[DRL] Finalized query round and created new bigentry log.\n";
+void DRLogSet::serialize(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(drlMutex);
+    // Taken with no query running, so only the QueryLog's open round can still be open here
+    std::vector<Block> currentDRL;
+    for (const auto& [round, entries] : openRounds) {
+        currentDRL.insert(currentDRL.end(), entries.begin(), entries.end());
+    }
+    writePod(out, static_cast<int32_t>(roundSizes.rbegin()->second.c));
+    writeBlocks(out, currentDRL);
+
+    writePod(out, static_cast<uint64_t>(bigentryLogs.size()));
+    for (size_t i = 0; i < bigentryLogs.size(); ++i) {
+        writeBlocks(out, bigentryLogs[i]);
+        writePod(out, static_cast<uint64_t>(searchIndices[i].size()));
+        for (int id : searchIndices[i]) {
+            writePod(out, static_cast<int32_t>(id));
+        }
     }
 }
 
+bool DRLogSet::deserialize(std::istream& in) {
+    int32_t newC = 0;
+    std::vector<Block> current;
+    uint64_t logCount = 0;
+    if (!readPod(in, newC) || !readBlocks(in, current) || !readPod(in, logCount)) return false;
 
-void DRLogSet::printCurrentDRL() const {
-    std::cout << "\n[Current DR-LogSet Contents]\n";
-    if (currentDRL.empty()) {
-        std::cout << "(Empty)\n";
-        return;
-    }
+    std::vector<std::vector<Block>> logs;
+    std::vector<std::vector<int>> indices;
+    for (uint64_t i = 0; i < logCount; ++i) {
+        std::vector<Block> log;
+        uint64_t indexSize = 0;
+        if (!readBlocks(in, log) || !readPod(in, indexSize)) return false;
 
-    for (const auto& b : currentDRL) {
-        std::cout << "  [ID: " << b.id
-        << ", Data: " << b.data
-        << ", Dummy: " << (b.isDummy ? "true" : "false") << "]\n";
+        std::vector<int> index;
+        for (uint64_t j = 0; j < indexSize; ++j) {
+            int32_t id = 0;
+            if (!readPod(in, id)) return false;
+            index.push_back(id);
+        }
+        logs.push_back(std::move(log));
+        indices.push_back(std::move(index));
     }
+
+    std::lock_guard<std::mutex> lock(drlMutex);
+    roundSizes = {{0, RoundSize{newC}}}; // rounds restart at 0, as in QueryLog::deserialize
+    openRounds.clear();
+    if (!current.empty()) openRounds[0] = std::move(current); // round 0, as in QueryLog::deserialize
+    bigentryLogs = std::move(logs);
+    searchIndices = std::move(indices);
+    return true;
+}
+
+void DRLogSet::restoreFrom(DRLogSet& parsed) {
+    std::scoped_lock lock(drlMutex, parsed.drlMutex);
+    roundSizes = parsed.roundSizes;
+    openRounds = std::move(parsed.openRounds);
+    bigentryLogs = std::move(parsed.bigentryLogs);
+    searchIndices = std::move(parsed.searchIndices);
+    parsed.openRounds.clear();
+    parsed.bigentryLogs.clear();
+    parsed.searchIndices.clear();
 }
@@ -4,25 +4,48 @@
 #include <vector>
 #include <algorithm>
 #include <random>
+#include <mutex>
+#include <map>
+#include <iosfwd>
 
 class DRLogSet {
 private:
-    int c; // Max number of parallel clients per round
-    std::vector<Block> currentDRL;  // one query round (i.e. two users requesting same data block)
-    // is equal to one currentDRL
+    // Round size c (the dummies added when a round is finalized), by the first round it applies
+    // to, so that a round is padded with the c it was opened under. An entry is dropped once all
+    // of its rounds are finalized and a newer one exists.
+    struct RoundSize {
+        int c;
+        long long finalized = 0; // rounds of this entry finalized so far
+    };
+    std::map<long long, RoundSize> roundSizes;
+    // Current DRLs of the rounds that are not finalized yet, keyed by the QueryLog's round number
+    // (one query round, i.e. two users requesting same data block, is equal to one currentDRL)
+    std::map<long long, std::vector<Block>> openRounds;
     std::vector<std::vector<Block>> bigentryLogs; //vector of vectors
     // stores the blocks that have been previously queried
     std::vector<std::vector<int>> searchIndices;
+    mutable std::mutex drlMutex; // queries from different clients write the same round
+
+    int finalizeLocked(long long round); // counts the round as finalized, returns its c
 
 public:
     explicit DRLogSet(int c);
 
-    void appendToCurrent(const Block& b);
+
+    void appendToCurrent(const Block& b, long long round);
 
     std::vector<Block> readLogSet(int blockId);
 
-    void finalizeRound(); // Called after c queries
-    void writeLogSet(const Block& blk, int queryId);
+    void finalizeRound(long long round); // Called once the round's queries have all completed
+    void finalizeRound();                // every open round, e.g. on shutdown
+    void writeLogSet(const Block& blk, long long round, int queryId);
     void printCurrentDRL() const;
+    int getRoundSize() const; // c of the newest rounds
+    void setRoundSize(int newC, long long fromRound); // padding of round fromRound and later ones
+    size_t getFinalizedRoundCount() const;
+
+    void serialize(std::ostream& out) const;
+    bool deserialize(std::istream& in);
+    void restoreFrom(DRLogSet& parsed); // takes over the state of one just deserialized
 
 };
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "ORAMQuery.h"
+#include "Random.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+LeafId randomLeaf(LeafId leafCount) {
+    return std::uniform_int_distribution<LeafId>(0, leafCount - 1)(randomEngine());
+}
+
+QueryPhaseTimings& queryPhaseTimings()
+{
+    static QueryPhaseTimings timings;
+    return timings;
+}
+
+static long long nanosSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printQueryPhaseTimings(const ORAMTree &tree)
+{
+    const QueryPhaseTimings &t = queryPhaseTimings();
+    long long queries = t.queries.load();
+    std::cout << "\n[Query Phases] " << queries << " path queries"
+              << (tree.isEncrypted() ? ", buckets encrypted\n" : ", buckets in plaintext\n");
+    if (queries == 0)
+        return;
+
+    auto perQuery = [queries](long long nanos) { return nanos / 1000.0 / queries; };
+    std::cout << "  Fetch path:  " << perQuery(t.fetchNanos) << " us/query\n";
+    std::cout << "  Stash:       " << perQuery(t.stashNanos) << " us/query\n";
+    std::cout << "  Evict path:  " << perQuery(t.evictNanos) << " us/query\n";
+    std::cout << "  DRL write:   " << perQuery(t.logNanos) << " us/query\n";
+    if (tree.isEncrypted())
+    {
+        // Tree-wide totals: they also cover dummy reads, forced evictions, displays and snapshots
+        std::cout << "  Decrypt:     " << perQuery(tree.getDecryptNanos()) << " us/query ("
+                  << tree.getBucketsDecrypted() << " buckets, all tree reads)\n";
+        std::cout << "  Re-encrypt:  " << perQuery(tree.getEncryptNanos()) << " us/query ("
+                  << tree.getBucketsEncrypted() << " buckets, all tree writes)\n";
+    }
+}
+
+void ORAMQuery::accessPath(LeafId leafId, const std::function<void()> &visit)
+{
+    tree.accessPath(leafId, [&](const std::vector<std::vector<Block> *> &buckets) {
+        // The stash keeps one copy per block ID
+        for (std::vector<Block> *bucket : buckets)
+        {
+            for (const Block &b : *bucket)
+                stash.addBlock(b);
+            bucket->clear();
+        }
+
+        if (visit)
+            visit();
+
+        evictPath(leafId, buckets);
+    });
+}
+
+void ORAMQuery::evictPath(LeafId leafId, const std::vector<std::vector<Block> *> &buckets)
+{
+    const int depth = tree.getDepth();
+    const NodeIndex evictLeaf = ORAMTree::Geometry::leafIndex(leafId, depth);
+
+    // Each block goes to the deepest bucket shared by the evicted path and its own path that
+    // still has room. It is put into the bucket before the stash lets go of it.
+    stash.evict([&](const Block &b) {
+        LeafId target = positionMap.getPosition(b.id);
+        if (target == -1)
+            return false; // not mapped to any path, has to stay in the stash
+
+        NodeIndex a = evictLeaf;
+        NodeIndex c = ORAMTree::Geometry::leafIndex(target, depth);
+        int level = depth;
+        while (a != c)
+        {
+            a = ORAMTree::Geometry::parent(a);
+            c = ORAMTree::Geometry::parent(c);
+            --level;
+        }
+
+        for (; level >= 0; --level)
+        {
+            std::vector<Block> &bucket = *buckets[level];
+            if (ORAMTree::bucketSize == kUnboundedBucket || static_cast<int>(bucket.size()) < ORAMTree::bucketSize)
+            {
+                bucket.push_back(b);
+                return true;
+            }
+        }
+        return false; // every bucket it may use is full, stays in the stash
+    });
+}
+
+void ORAMQuery::relieveStashPressure()
+{
+    for (int i = 0; i < kMaxForcedEvictions && stash.isOverCapacity(); ++i)
+    {
+        accessPath(randomLeaf(tree.getLeafCount()));
+        stash.recordForcedEviction();
+    }
+}
+
+void ORAMQuery::dummyRead()
+{
+    read(QueryLog::kPaddingBlockId); // never mapped, so it takes the unmapped-block sequence below
+}
+
+void ORAMQuery::randomPathAccess()
+{
+    if (ring != nullptr)
+    {
+        ring->dummyAccess();
+        return;
+    }
+
+    accessPath(randomLeaf(tree.getLeafCount()));
+}
+
+Block ORAMQuery::read(int blockId)
+{
+    auto active = queryLog.enterQuery(); // keeps snapshots from cutting through this query
+
+    if (ring == nullptr)
+        relieveStashPressure(); // Ring ORAM drains the stash through its own scheduled evictions
+
+    QueryTicket ticket = queryLog.registerQuery(blockId);
+    Block result = ticket.overlap ? readOverlapped(blockId, ticket) : readPath(blockId, ticket);
+
+    // The last query of a sealed round to finish hands the round over to a bigentry log
+    long long drained = queryLog.completeQuery(ticket);
+    if (drained >= 0)
+        drLogSet.finalizeRound(drained);
+    return result;
+}
+
+Block ORAMQuery::readOverlapped(int blockId, const QueryTicket &ticket)
+{
+    cout << "Overlapped Block:" << " " << blockId << endl;
+    // Dummy read (simulate a random path fetch but ignore result)
+    randomPathAccess();
+
+    // Every query writes one DRL entry, so a DRL round holds exactly its QueryLog round
+    drLogSet.writeLogSet(Block(-1, "", true), ticket.round, ticket.queryId);
+
+    // Wait until the earlier query of this block has written its result; a query that already
+    // finished (always the case on a serial partition worker) costs no wait at all
+    queryLog.waitForOverlapped(ticket);
+
+    // Try to get it from the DRLogSet
+    auto results = drLogSet.readLogSet(blockId);
+    for (const auto &b : results) {
+        if (b.id == blockId)
+            return b;
+    }
+
+    return Block(-1, "", true); // If still not found
+}
+
+Block ORAMQuery::readPath(int blockId, const QueryTicket &ticket)
+{
+    LeafId leafId = positionMap.getPosition(blockId);
+    if (leafId == -1)
+    {
+        // Same path read and DRL write as a hit, so the server cannot tell the two apart
+        randomPathAccess();
+        Block dummy(-1, "", true);
+        drLogSet.writeLogSet(dummy, ticket.round, ticket.queryId);
+        return dummy;
+    }
+
+    if (ring != nullptr)
+    {
+        // One block per bucket online; remapping and eviction happen inside the engine
+        Block result = ring->access(blockId);
+        drLogSet.writeLogSet(result, ticket.round, ticket.queryId);
+        return result;
+    }
+
+    QueryPhaseTimings &timings = queryPhaseTimings();
+    auto phaseStart = std::chrono::steady_clock::now();
+
+    Block result(-1, "", true);
+    accessPath(leafId, [&]() {
+        timings.fetchNanos += nanosSince(phaseStart);
+        phaseStart = std::chrono::steady_clock::now();
+
+        result = stash.fetchBlock(blockId);
+        if (result.id == -1)
+        {
+            result = Block(-1, "", true);
+        }
+        else
+        {
+            // Remap the block to a fresh path and keep it in the stash until it is evicted
+            positionMap.updatePosition(blockId, randomLeaf(tree.getLeafCount()));
+            stash.addBlock(result);
+        }
+        timings.stashNanos += nanosSince(phaseStart);
+        phaseStart = std::chrono::steady_clock::now();
+    });
+    timings.evictNanos += nanosSince(phaseStart);
+    phaseStart = std::chrono::steady_clock::now();
+
+    drLogSet.writeLogSet(result, ticket.round, ticket.queryId);
+    timings.logNanos += nanosSince(phaseStart);
+    ++timings.queries;
+
+    return result;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Block.h"
+#include "ORAMTree.h"
+#include "PositionMap.h"
+#include "Stash.h"
+#include "DRLogSet.h"
+#include "QueryLog.h"
+#include "RingORAM.h"
+#include <atomic>
+#include <functional>
+
+// Uniformly random leaf from the shared randomEngine() (64-bit, so deep sparse trees are covered)
+LeafId randomLeaf(LeafId leafCount);
+
+// Time spent in each phase of a Path ORAM query, summed over all queries
+struct QueryPhaseTimings {
+    std::atomic<long long> queries{0};
+    std::atomic<long long> fetchNanos{0}; // path locking and read, including bucket decryption
+    std::atomic<long long> stashNanos{0};
+    std::atomic<long long> evictNanos{0}; // eviction and path write-back, including re-encryption
+    std::atomic<long long> logNanos{0};
+};
+
+QueryPhaseTimings& queryPhaseTimings();
+void printQueryPhaseTimings(const ORAMTree& tree);
+
+// ORAM Query
+class ORAMQuery {
+private:
+    ORAMTree& tree;
+    PositionMap& positionMap;
+    Stash& stash;
+    DRLogSet& drLogSet;
+    QueryLog& queryLog;
+    RingORAM* ring; // Ring ORAM mode when set: path accesses go to the ring engine instead of the tree
+
+    // Forced evictions a query may run before it proceeds anyway while the stash is over capacity
+    static constexpr int kMaxForcedEvictions = 8;
+
+    // One Path ORAM access, run while the tree holds the whole path locked: the path's blocks
+    // move into the stash, visit runs on the stash, and the stash is evicted back down the path.
+    // No other query ever sees a block that is in neither the path nor the stash.
+    void accessPath(LeafId leafId, const std::function<void()>& visit = nullptr);
+    void evictPath(LeafId leafId, const std::vector<std::vector<Block>*>& buckets);
+    void relieveStashPressure();    // backpressure: evict random paths while the stash is over capacity
+    void randomPathAccess();        // the dummy read itself, for callers already inside a query
+
+    Block readOverlapped(int blockId, const QueryTicket& ticket); // served from the DR-LogSet
+    Block readPath(int blockId, const QueryTicket& ticket);
+
+public:
+    ORAMQuery(ORAMTree& tree, PositionMap& positionMap, Stash& stash, DRLogSet& drLogSet, QueryLog& queryLog,
+              RingORAM* ring = nullptr)
+        : tree(tree), positionMap(positionMap), stash(stash), drLogSet(drLogSet), queryLog(queryLog), ring(ring) {}
+
+    // Main PathORAM-style Read Operation
+    Block read(int blockId);
+
+    // A padding query: takes a slot in the open round, reads and evicts a random path and writes
+    // a dummy DRL entry, the same sequence as a real read, so the server cannot tell them apart
+    void dummyRead();
+};
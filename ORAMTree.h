@@ -1,20 +1,125 @@
 #pragma once
 #include "TreeNode.h"
+#include "TreeGeometry.h"
 #include <unordered_map>
 #include <shared_mutex>
+#include <atomic>
+#include <array>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+// Bucket size used for "no limit on blocks per bucket"
+constexpr int kUnboundedBucket = 0;
+
+// Deepest tree that may allocate every bucket up front; deeper trees have to be sparse
+constexpr int kMaxDenseDepth = 22;
+
+// The treetop is a dense array, so a sparse tree caches at most this many levels
+// (2^16 - 1 binary buckets) instead of growing back to the size sparse mode avoids
+constexpr int kMaxSparseTreetopLevels = 16;
+
+// ORAM tree with compile-time geometry: Z blocks per bucket (kUnboundedBucket for no limit)
+// and Arity children per node. Member definitions live in ORAMtree.cpp, which explicitly
+// instantiates the geometries listed at its bottom.
+template <int Z, int Arity>
+class BasicORAMTree {
+public:
+    using Geometry = TreeGeometry<Arity>;
+    static constexpr int bucketSize = Z;
+    static constexpr int arity = Arity;
+
+    // Gets the plaintext buckets of one path, root first, to edit in place
+    using PathVisitor = std::function<void(const std::vector<std::vector<Block>*>& buckets)>;
 
-class ORAMTree {
 private:
-    std::unordered_map<int, TreeNode> tree;
+    std::unordered_map<NodeIndex, TreeNode> tree; // server-resident buckets
     int depth;
-    mutable std::shared_mutex treeMutex;
+    bool sparse; // buckets are only allocated when first written
+
+    // Locking is two-level. structureMutex guards which buckets exist (map insertions, treetop
+    // resizing, restore) and is held shared by every bucket access. Bucket contents are guarded
+    // by striped per-bucket locks, so single-bucket operations (getNode, addBlock, takeBlock) on
+    // different buckets never block each other. A path access holds its path's stripes
+    // exclusively for the whole access; since every path contains the root, path accesses are
+    // serialized, and what runs in parallel is the work queries do outside them (position map,
+    // DR-LogSet, stash pressure checks). Lock order: structureMutex, then bucket stripes in
+    // ascending stripe order.
+    static constexpr size_t kLockStripes = 64;
+    mutable std::shared_mutex structureMutex;
+    mutable std::array<std::shared_mutex, kLockStripes> bucketLocks;
+
+    // Treetop cache: the top treetopLevels levels are kept on the client in a flat array
+    // indexed by node index, so they never cost a server fetch
+    int treetopLevels;
+    std::vector<TreeNode> treetop;
+    mutable std::atomic<long long> serverBucketReads{0};
+    mutable std::atomic<long long> treetopBucketReads{0};
+
+    // Encryption: with a cipher set, every server-resident bucket is kept sealed, empty ones
+    // included, so a blank bucket fails authentication (the treetop stays in plaintext on the
+    // client). A sparse bucket the server does not hold at all still reads as empty: the client
+    // does not track which ones exist. Paths are opened and sealed as one batch.
+    std::shared_ptr<BucketCipher> cipher;
+    mutable std::atomic<long long> decryptNanos{0};
+    mutable std::atomic<long long> encryptNanos{0};
+    mutable std::atomic<long long> bucketsDecrypted{0};
+    mutable std::atomic<long long> bucketsEncrypted{0};
+
+    bool inTreetop(NodeIndex index) const { return index < static_cast<NodeIndex>(treetop.size()); }
+    static size_t stripeOf(NodeIndex index) { return static_cast<size_t>(index) % kLockStripes; }
+
+    // Callers hold structureMutex (and the bucket's stripe for readBucket)
+    TreeNode* findNode(NodeIndex index);
+    TreeNode readBucket(NodeIndex index) const; // as stored, i.e. still sealed on the server
+
+    // Turn sealed server buckets into plaintext ones and back, whole batches at a time
+    void openNodes(const std::vector<NodeIndex>& indices, const std::vector<TreeNode*>& nodes) const;
+    void sealNodes(const std::vector<NodeIndex>& indices, const std::vector<TreeNode*>& nodes);
+    void visitPath(const std::vector<NodeIndex>& indices, const PathVisitor& visit);
+    void adoptBuckets(int newDepth, bool newSparse, std::unordered_map<NodeIndex, TreeNode> restored);
 
 public:
-    explicit ORAMTree(int depth);
+    explicit BasicORAMTree(int depth, int treetopLevels = 0, bool sparse = false);
     void initializeTree();
-    void addBlock(int index, const Block& block);
-    TreeNode getNode(int index) const;
-    std::vector<int> getPathIndices(int leafId);
+    bool addBlock(NodeIndex index, const Block& block); // false if the bucket already holds Z blocks
+    TreeNode getNode(NodeIndex index) const;
+    // Runs visit with every bucket on the path locked exclusively and opened, then re-seals the
+    // path as one batch. Whatever visit moves between the path and elsewhere (e.g. the stash) is
+    // never visible half-done to another path access. In a sparse tree, missing buckets are
+    // created for the visit and those still empty afterwards are freed again.
+    // Every path shares the root's stripe, so path accesses run one at a time.
+    void accessPath(LeafId leafId, const PathVisitor& visit);
+    Block takeBlock(NodeIndex index, int blockId); // removes the block from the bucket, dummy if absent
+    std::vector<NodeIndex> getPathIndices(LeafId leafId) const;
     int getDepth() const;
+    LeafId getLeafCount() const;
+    NodeIndex getNodeCount() const;
+    bool isSparse() const;
+    size_t getAllocatedBucketCount() const;
+
+    // Treetop cache
+    void setTreetopLevels(int levels); // moves buckets between the cache and the server map; clamped to the tree
+    int getTreetopLevels() const;
+    long long getServerBucketReads() const;
+    long long getTreetopBucketReads() const;
+
+    // Bucket encryption
+    void enableEncryption(const BucketKey& key); // seals every server bucket from now on
+    bool isEncrypted() const;
+    long long getDecryptNanos() const;
+    long long getEncryptNanos() const;
+    long long getBucketsDecrypted() const;
+    long long getBucketsEncrypted() const;
+
+    // Snapshot support, see Snapshot.h
+    void serialize(std::ostream& out) const;
+    bool deserialize(std::istream& in, uint32_t formatVersion);
+    void restoreFrom(BasicORAMTree& parsed); // takes over the buckets of a tree just deserialized
 
 };
+
+// The tree the query engine runs on: binary, Z = 4 as in Path ORAM, so eviction has to
+// respect bucket capacity and whatever does not fit stays in the (bounded) stash
+using ORAMTree = BasicORAMTree<4, 2>;
@@ -1,46 +1,511 @@
 #include "ORAMTree.h"
 #include <mutex>  // Required for std::unique_lock and std::shared_mutex
 #include <iostream>
+#include <chrono>
 using namespace std;
 #include <algorithm>  // for std::reverse
+#include "Serialization.h"
 
-ORAMTree::ORAMTree(int depth) : depth(depth) {
+template <int Z, int Arity>
+BasicORAMTree<Z, Arity>::BasicORAMTree(int depth, int treetopLevels, bool sparse)
+    : depth(depth), sparse(sparse), treetopLevels(0) {
     initializeTree();
+    setTreetopLevels(treetopLevels);
 }
 
-void ORAMTree::initializeTree() {
-    int totalNodes = (1 << (depth + 1)) - 1; // depth starts from 0 therefore total nodes = 2^(depth+1) - 1
-    cout << "Total nodes in the tree: " << totalNodes << endl;
-    for (int i = 0; i < totalNodes; ++i) {
-        tree[i] = TreeNode();
+template <int Z, int Arity>
+void BasicORAMTree<Z, Arity>::initializeTree() {
+    NodeIndex totalNodes = Geometry::nodeCount(depth); // depth starts from 0 therefore total nodes = (A^(depth+1) - 1) / (A - 1)
+    cout << "Total nodes in the tree: " << totalNodes << (sparse ? " (sparse, allocated on first write)" : "") << endl;
+    if (sparse) return;
+
+    for (NodeIndex i = static_cast<NodeIndex>(treetop.size()); i < totalNodes; ++i) {
+        tree.try_emplace(i);
+    }
+}
+
+template <int Z, int Arity>
+TreeNode* BasicORAMTree<Z, Arity>::findNode(NodeIndex index) {
+    if (inTreetop(index)) return &treetop[index];
+    auto it = tree.find(index);
+    return (it != tree.end()) ? &it->second : nullptr;
+}
+
+template <int Z, int Arity>
+TreeNode BasicORAMTree<Z, Arity>::readBucket(NodeIndex index) const {
+    if (inTreetop(index)) {
+        ++treetopBucketReads;
+        return treetop[index];
+    }
+    ++serverBucketReads;
+
+    auto it = tree.find(index);
+    if (it != tree.end()) return it->second;
+    if (sparse && index >= 0 && index < Geometry::nodeCount(depth)) {
+        return TreeNode(); // never written, so still empty
+    }
+    return tree.at(index); // invalid index, throws
+}
+
+template <int Z, int Arity>
+void BasicORAMTree<Z, Arity>::openNodes(const std::vector<NodeIndex>& indices, const std::vector<TreeNode*>& nodes) const {
+    if (!cipher) return;
+
+    // Every server bucket carries ciphertext, so a blank one fails authentication like a tampered
+    // one. Only treetop buckets are plaintext already (those just pulled in are still sealed).
+    std::vector<NodeIndex> batchIndices;
+    std::vector<SealedBucket> batch;
+    std::vector<TreeNode*> targets;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (inTreetop(indices[i]) && nodes[i]->sealed.isBlank()) continue;
+        batchIndices.push_back(indices[i]);
+        batch.push_back(std::move(nodes[i]->sealed));
+        targets.push_back(nodes[i]);
+    }
+    if (batch.empty()) return;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<Block>> opened;
+    if (!cipher->openBatch(batchIndices, batch, opened)) {
+        cerr << "Error: A bucket on the path failed authentication; its contents were dropped." << endl;
+    }
+    for (size_t i = 0; i < targets.size(); ++i) {
+        targets[i]->bucket = std::move(opened[i]);
+        targets[i]->sealed = SealedBucket();
+    }
+    decryptNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    bucketsDecrypted += static_cast<long long>(targets.size());
+}
+
+template <int Z, int Arity>
+void BasicORAMTree<Z, Arity>::sealNodes(const std::vector<NodeIndex>& indices, const std::vector<TreeNode*>& nodes) {
+    if (!cipher) return;
+
+    std::vector<NodeIndex> batchIndices;
+    std::vector<std::vector<Block>> batch;
+    std::vector<TreeNode*> targets;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (inTreetop(indices[i])) continue;
+        batchIndices.push_back(indices[i]);
+        batch.push_back(std::move(nodes[i]->bucket));
+        targets.push_back(nodes[i]);
+    }
+    if (batch.empty()) return;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SealedBucket> sealed = cipher->sealBatch(batchIndices, batch);
+    for (size_t i = 0; i < targets.size(); ++i) {
+        targets[i]->bucket.clear();
+        targets[i]->sealed = std::move(sealed[i]);
+    }
+    encryptNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    bucketsEncrypted += static_cast<long long>(targets.size());
+}
+
+template <int Z, int Arity>
+bool BasicORAMTree<Z, Arity>::addBlock(NodeIndex index, const Block& block) {
+    auto append = [&](TreeNode& node) {
+        openNodes({index}, {&node});
+        bool added = (Z == kUnboundedBucket || static_cast<int>(node.bucket.size()) < Z);
+        if (added) node.bucket.push_back(block);
+        sealNodes({index}, {&node});
+        return added;
+    };
+
+    // Common case: the bucket exists, only its stripe is taken exclusively.
+    // Treetop writes go straight into the client-side cache.
+    {
+        std::shared_lock structure(structureMutex);
+        if (TreeNode* node = findNode(index)) {
+            std::unique_lock bucket(bucketLocks[stripeOf(index)]);
+            return append(*node);
+        }
+    }
+
+    // Sparse mode, first write to this bucket: materialize it under the structure lock, sealed
+    // like every other server bucket
+    std::unique_lock structure(structureMutex);
+    auto [it, created] = tree.try_emplace(index);
+    if (created) sealNodes({index}, {&it->second});
+    return append(it->second);
+}
+
+template <int Z, int Arity>
+TreeNode BasicORAMTree<Z, Arity>::getNode(NodeIndex index) const {
+    TreeNode node;
+    bool stored;
+    {
+        std::shared_lock structure(structureMutex);
+        std::shared_lock bucket(bucketLocks[stripeOf(index)]);
+        node = readBucket(index);
+        stored = inTreetop(index) || tree.count(index) != 0; // else a sparse bucket never written
     }
+    if (stored) openNodes({index}, {&node});
+    return node;
 }
 
-void ORAMTree::addBlock(int index, const Block& block) {
-    std::unique_lock lock(treeMutex);
-    tree[index].bucket.push_back(block);
+template <int Z, int Arity>
+void BasicORAMTree<Z, Arity>::accessPath(LeafId leafId, const PathVisitor& visit) {
+    std::vector<NodeIndex> indices = getPathIndices(leafId);
+
+    std::vector<size_t> stripes;
+    for (NodeIndex idx : indices) stripes.push_back(stripeOf(idx));
+    std::sort(stripes.begin(), stripes.end());
+    stripes.erase(std::unique(stripes.begin(), stripes.end()), stripes.end());
+
+    // Dense mode: every bucket exists, so only the path's stripes are taken
+    if (!sparse) {
+        std::shared_lock structure(structureMutex);
+        std::vector<std::unique_lock<std::shared_mutex>> held;
+        held.reserve(stripes.size());
+        for (size_t s : stripes) held.emplace_back(bucketLocks[s]);
+        visitPath(indices, visit);
+        return;
+    }
+
+    // Sparse mode: the missing buckets are created for the visit and whatever is still empty
+    // afterwards is freed again, so only occupied buckets stay allocated. Both change the map,
+    // so the structure lock is taken exclusively; it covers the stripes. Path accesses are
+    // serialized on the root's stripe anyway, so this only holds off single-bucket operations.
+    std::unique_lock structure(structureMutex);
+    std::vector<NodeIndex> created;
+    std::vector<TreeNode*> createdNodes;
+    for (NodeIndex idx : indices) {
+        if (findNode(idx) != nullptr) continue;
+        created.push_back(idx);
+        createdNodes.push_back(&tree[idx]);
+    }
+    sealNodes(created, createdNodes); // the visit opens every server bucket, new ones included
+    visitPath(indices, visit);
 }
 
-TreeNode ORAMTree::getNode(int index) const {
-    std::shared_lock lock(treeMutex);
-    return tree.at(index);
+template <int Z, int Arity>
+void BasicORAMTree<Z, Arity>::visitPath(const std::vector<NodeIndex>& indices, const PathVisitor& visit) {
+    std::vector<TreeNode*> nodes;
+    std::vector<std::vector<Block>*> buckets;
+    for (NodeIndex idx : indices) {
+        if (inTreetop(idx)) ++treetopBucketReads; else ++serverBucketReads;
+        TreeNode* node = findNode(idx);
+        nodes.push_back(node);
+        buckets.push_back(&node->bucket);
+    }
+
+    openNodes(indices, nodes);
+    visit(buckets);
+
+    if (sparse) {
+        // Callers hold the structure lock exclusively in sparse mode (see accessPath)
+        std::vector<NodeIndex> keptIndices;
+        std::vector<TreeNode*> kept;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (!inTreetop(indices[i]) && nodes[i]->bucket.empty()) {
+                tree.erase(indices[i]);
+                continue;
+            }
+            keptIndices.push_back(indices[i]);
+            kept.push_back(nodes[i]);
+        }
+        sealNodes(keptIndices, kept);
+        return;
+    }
+    sealNodes(indices, nodes);
 }
 
+template <int Z, int Arity>
+Block BasicORAMTree<Z, Arity>::takeBlock(NodeIndex index, int blockId) {
+    std::shared_lock structure(structureMutex);
+    TreeNode* node = findNode(index);
+    if (node == nullptr) return Block(-1, "", true);
+    std::unique_lock bucket(bucketLocks[stripeOf(index)]);
+    openNodes({index}, {node});
+
+    Block block(-1, "", true);
+    for (auto it = node->bucket.begin(); it != node->bucket.end(); ++it) {
+        if (it->id == blockId) {
+            block = std::move(*it);
+            node->bucket.erase(it);
+            break;
+        }
+    }
+    sealNodes({index}, {node});
+    return block;
+}
 
 // Returns node indices from root to the given leaf ID
-std::vector<int> ORAMTree::getPathIndices(int leafId) {
-    std::vector<int> path;
-    int index = leafId + (1 << depth) - 1; // index of leaf node in array representation
+template <int Z, int Arity>
+std::vector<NodeIndex> BasicORAMTree<Z, Arity>::getPathIndices(LeafId leafId) const {
+    std::vector<NodeIndex> path;
+    NodeIndex index = Geometry::leafIndex(leafId, depth); // index of leaf node in array representation
     while (index >= 0) {
         path.push_back(index);
         if (index == 0) break;
-        index = (index - 1) / 2; // go to parent
+        index = Geometry::parent(index); // go to parent
     }
     std::reverse(path.begin(), path.end()); // from root to leaf
     return path;
 }
 
 
-int ORAMTree::getDepth() const {
+template <int Z, int Arity>
+int BasicORAMTree<Z, Arity>::getDepth() const {
     return depth;
 }
+
+template <int Z, int Arity>
+LeafId BasicORAMTree<Z, Arity>::getLeafCount() const {
+    return Geometry::leafCount(depth);
+}
+
+template <int Z, int Arity>
+NodeIndex BasicORAMTree<Z, Arity>::getNodeCount() const {
+    return Geometry::nodeCount(depth);
+}
+
+template <int Z, int Arity>
+bool BasicORAMTree<Z, Arity>::isSparse() const {
+    return sparse;
+}
+
+template <int Z, int Arity>
+size_t BasicORAMTree<Z, Arity>::getAllocatedBucketCount() const {
+    std::shared_lock structure(structureMutex);
+    return treetop.size() + tree.size();
+}
+
+
+template <int Z, int Arity>
+void BasicORAMTree<Z, Arity>::setTreetopLevels(int levels) {
+    std::unique_lock structure(structureMutex);
+    levels = std::max(0, std::min(levels, depth + 1));
+    if (sparse) levels = std::min(levels, kMaxSparseTreetopLevels);
+    NodeIndex cachedNodes = Geometry::levelStart(levels);
+
+    // Hand back levels that are no longer cached to the server (empty buckets stay unallocated in sparse mode)
+    std::vector<NodeIndex> returned;
+    for (NodeIndex i = cachedNodes; i < static_cast<NodeIndex>(treetop.size()); ++i) {
+        if (!sparse || !treetop[i].bucket.empty()) {
+            tree[i] = std::move(treetop[i]);
+            returned.push_back(i);
+        }
+    }
+    treetop.resize(cachedNodes);
+
+    // Pull newly cached levels over from the server
+    std::vector<NodeIndex> pulled;
+    for (NodeIndex i = 0; i < cachedNodes; ++i) {
+        auto it = tree.find(i);
+        if (it != tree.end()) {
+            treetop[i] = std::move(it->second);
+            tree.erase(it);
+            pulled.push_back(i);
+        }
+    }
+
+    // The server only ever holds sealed buckets, the client cache only plaintext ones
+    std::vector<TreeNode*> nodes;
+    for (NodeIndex i : returned) nodes.push_back(&tree[i]);
+    sealNodes(returned, nodes);
+    nodes.clear();
+    for (NodeIndex i : pulled) nodes.push_back(&treetop[i]);
+    openNodes(pulled, nodes);
+
+    treetopLevels = levels;
+    if (levels > 0) {
+        cout << "Treetop cache: top " << levels << " level(s), " << cachedNodes
+             << " bucket(s) kept on the client" << endl;
+    }
+}
+
+template <int Z, int Arity>
+int BasicORAMTree<Z, Arity>::getTreetopLevels() const {
+    std::shared_lock structure(structureMutex);
+    return treetopLevels;
+}
+
+template <int Z, int Arity>
+long long BasicORAMTree<Z, Arity>::getServerBucketReads() const {
+    return serverBucketReads.load();
+}
+
+template <int Z, int Arity>
+long long BasicORAMTree<Z, Arity>::getTreetopBucketReads() const {
+    return treetopBucketReads.load();
+}
+
+
+template <int Z, int Arity>
+void BasicORAMTree<Z, Arity>::enableEncryption(const BucketKey& key) {
+    std::unique_lock structure(structureMutex);
+    if (cipher) return;
+    cipher = std::make_shared<BucketCipher>(key);
+
+    // Empty buckets are sealed too: a blank server bucket is then always a failed authentication
+    std::vector<NodeIndex> indices;
+    std::vector<TreeNode*> nodes;
+    for (auto& [index, node] : tree) {
+        indices.push_back(index);
+        nodes.push_back(&node);
+    }
+    sealNodes(indices, nodes);
+    cout << "Server buckets are sealed with ChaCha20-Poly1305 (" << indices.size() << " bucket(s) encrypted)" << endl;
+}
+
+template <int Z, int Arity>
+bool BasicORAMTree<Z, Arity>::isEncrypted() const {
+    std::shared_lock structure(structureMutex);
+    return cipher != nullptr;
+}
+
+template <int Z, int Arity>
+long long BasicORAMTree<Z, Arity>::getDecryptNanos() const {
+    return decryptNanos.load();
+}
+
+template <int Z, int Arity>
+long long BasicORAMTree<Z, Arity>::getEncryptNanos() const {
+    return encryptNanos.load();
+}
+
+template <int Z, int Arity>
+long long BasicORAMTree<Z, Arity>::getBucketsDecrypted() const {
+    return bucketsDecrypted.load();
+}
+
+template <int Z, int Arity>
+long long BasicORAMTree<Z, Arity>::getBucketsEncrypted() const {
+    return bucketsEncrypted.load();
+}
+
+
+template <int Z, int Arity>
+void BasicORAMTree<Z, Arity>::serialize(std::ostream& out) const {
+    // All stripes are held shared so the snapshot sees one consistent tree
+    std::shared_lock structure(structureMutex);
+    std::vector<std::shared_lock<std::shared_mutex>> held;
+    for (auto& stripe : bucketLocks) held.emplace_back(stripe);
+
+    writePod(out, static_cast<int32_t>(depth));
+    writePod(out, static_cast<uint8_t>(sparse ? 1 : 0));
+    writePod(out, static_cast<uint64_t>(treetop.size() + tree.size()));
+
+    // The treetop is part of the tree as far as the snapshot is concerned
+    for (NodeIndex index = 0; index < static_cast<NodeIndex>(treetop.size()); ++index) {
+        writePod(out, static_cast<int64_t>(index));
+        writeBlocks(out, treetop[index].bucket);
+    }
+
+    // Nodes are written in index order so that two snapshots of the same tree are byte-identical
+    std::vector<NodeIndex> indices;
+    indices.reserve(tree.size());
+    for (const auto& [index, node] : tree) indices.push_back(index);
+    std::sort(indices.begin(), indices.end());
+
+    // Snapshots hold plaintext; the tree re-seals what it restores under its own key
+    for (NodeIndex index : indices) {
+        TreeNode node = tree.at(index);
+        openNodes({index}, {&node});
+        writePod(out, static_cast<int64_t>(index));
+        writeBlocks(out, node.bucket);
+    }
+}
+
+template <int Z, int Arity>
+bool BasicORAMTree<Z, Arity>::deserialize(std::istream& in, uint32_t formatVersion) {
+    // v1 trees are always dense and use 32-bit node indices
+    int32_t newDepth = 0;
+    uint8_t newSparse = 0;
+    uint64_t nodeCount = 0;
+    if (!readPod(in, newDepth)) return false;
+    if (formatVersion >= 2 && !readPod(in, newSparse)) return false;
+    if (!readPod(in, nodeCount)) return false;
+
+    // Nothing from the file is trusted: a bad depth or index would otherwise allocate without bound
+    const int depthLimit = newSparse ? Geometry::maxDepth() : std::min(Geometry::maxDepth(), kMaxDenseDepth);
+    if (newDepth < 0 || newDepth > depthLimit) {
+        cerr << "Error: Snapshot tree depth " << newDepth << " is outside 0 to " << depthLimit
+             << (newSparse ? "." : " for a dense tree.") << endl;
+        return false;
+    }
+    const NodeIndex totalNodes = Geometry::nodeCount(newDepth);
+    if (nodeCount > static_cast<uint64_t>(totalNodes)) {
+        cerr << "Error: Snapshot holds " << nodeCount << " buckets for a tree of " << totalNodes << "." << endl;
+        return false;
+    }
+
+    std::unordered_map<NodeIndex, TreeNode> restored;
+    for (uint64_t i = 0; i < nodeCount; ++i) {
+        int64_t index = 0;
+        TreeNode node;
+        if (formatVersion >= 2) {
+            if (!readPod(in, index)) return false;
+        } else {
+            int32_t narrowIndex = 0;
+            if (!readPod(in, narrowIndex)) return false;
+            index = narrowIndex;
+        }
+        if (!readBlocks(in, node.bucket)) return false;
+        if (index < 0 || index >= totalNodes || restored.count(index) != 0) {
+            cerr << "Error: Snapshot bucket index " << index << " is invalid or repeated." << endl;
+            return false;
+        }
+        if (Z != kUnboundedBucket && static_cast<int>(node.bucket.size()) > Z) {
+            cerr << "Error: Snapshot bucket " << index << " holds more than " << Z << " blocks." << endl;
+            return false;
+        }
+        restored[index] = std::move(node);
+    }
+
+    adoptBuckets(newDepth, newSparse != 0, std::move(restored));
+    return true;
+}
+
+
+template <int Z, int Arity>
+void BasicORAMTree<Z, Arity>::restoreFrom(BasicORAMTree& parsed) {
+    std::unordered_map<NodeIndex, TreeNode> restored;
+    {
+        std::unique_lock parsedStructure(parsed.structureMutex);
+        // Plaintext throughout: the parsed tree has no cipher; cached levels go back with the rest
+        for (NodeIndex i = 0; i < static_cast<NodeIndex>(parsed.treetop.size()); ++i) {
+            if (!parsed.treetop[i].bucket.empty()) parsed.tree[i] = std::move(parsed.treetop[i]);
+        }
+        parsed.treetop.clear();
+        restored = std::move(parsed.tree);
+        parsed.tree.clear();
+    }
+    adoptBuckets(parsed.depth, parsed.sparse, std::move(restored));
+}
+
+template <int Z, int Arity>
+void BasicORAMTree<Z, Arity>::adoptBuckets(int newDepth, bool newSparse, std::unordered_map<NodeIndex, TreeNode> restored) {
+    {
+        std::unique_lock structure(structureMutex);
+        depth = newDepth;
+        sparse = newSparse;
+        tree = std::move(restored);
+        treetop.clear();
+
+        // A dense tree keeps every bucket allocated, including the ones the snapshot left empty
+        if (!sparse) {
+            for (NodeIndex i = 0; i < Geometry::nodeCount(depth); ++i) {
+                tree.try_emplace(i);
+            }
+        }
+
+        std::vector<NodeIndex> indices;
+        std::vector<TreeNode*> nodes;
+        for (auto& [index, node] : tree) {
+            indices.push_back(index);
+            nodes.push_back(&node);
+        }
+        sealNodes(indices, nodes);
+    }
+
+    // Re-apply the client's treetop configuration to the restored tree
+    setTreetopLevels(treetopLevels);
+}
+
+// Geometries available to the query engine and the benchmark driver
+template class BasicORAMTree<4, 2>;
+template class BasicORAMTree<4, 4>;
+template class BasicORAMTree<4, 8>;
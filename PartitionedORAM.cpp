@@ -0,0 +1,215 @@
+#include "PartitionedORAM.h"
+#include "ORAMQuery.h"
+#include "Random.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+// Pins a worker to one core so partitions do not migrate onto each other's caches
+static void pinToCore(std::thread& t, int core) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    if (pthread_setaffinity_np(t.native_handle(), sizeof(cpus), &cpus) != 0) {
+        std::cerr << "Warning: Could not pin partition worker to core " << core << ".\n";
+    }
+#else
+    (void)t;
+    (void)core;
+#endif
+}
+
+PartitionedORAM::PartitionedORAM(int numPartitions, int depth, int c, int reshuffleInterval, bool sparse)
+    : reshuffleInterval(std::max(1, reshuffleInterval)) // never pin a block to one partition for good
+{
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    if (cores < 1) cores = 1;
+
+    for (int i = 0; i < numPartitions; ++i) {
+        partitions.push_back(std::make_unique<Partition>(depth, c, sparse));
+    }
+    for (int i = 0; i < numPartitions; ++i) {
+        Partition& p = *partitions[i];
+        p.worker = std::thread(&PartitionedORAM::workerLoop, this, std::ref(p));
+        pinToCore(p.worker, i % cores);
+    }
+}
+
+PartitionedORAM::~PartitionedORAM() {
+    for (auto& p : partitions) {
+        {
+            std::lock_guard<std::mutex> lock(p->queueMutex);
+            p->stopping = true;
+        }
+        p->queueCv.notify_one();
+    }
+    for (auto& p : partitions) {
+        p->worker.join();
+    }
+}
+
+void PartitionedORAM::workerLoop(Partition& p) {
+    ORAMQuery query(p.tree, p.positionMap, p.stash, p.drl, p.qlog);
+
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(p.queueMutex);
+            p.queueCv.wait(lock, [&p] { return p.stopping || !p.queue.empty(); });
+            if (p.queue.empty()) return; // stopping and drained
+            request = std::move(p.queue.front());
+            p.queue.pop_front();
+        }
+
+        // Each partition runs its own query rounds of c queries; its QueryLog seals them
+        Block block = query.read(request.blockId);
+        ++p.served;
+        request.result.set_value(std::move(block));
+    }
+}
+
+int PartitionedORAM::randomPartition() const {
+    return std::uniform_int_distribution<int>(0, static_cast<int>(partitions.size()) - 1)(randomEngine());
+}
+
+void PartitionedORAM::placeBlock(Partition& p, const Block& block) {
+    auto gate = p.qlog.quiesce(); // the partition's worker may be serving other blocks meanwhile
+
+    LeafId leaf = randomLeaf(p.tree.getLeafCount());
+    p.positionMap.updatePosition(block.id, leaf);
+
+    // A full leaf bucket leaves the block in the stash; the next access down its path evicts it
+    if (!p.tree.addBlock(ORAMTree::Geometry::leafIndex(leaf, p.tree.getDepth()), block)) {
+        p.stash.addBlock(block);
+    }
+}
+
+Block PartitionedORAM::takeBlock(Partition& p, int blockId) {
+    auto gate = p.qlog.quiesce();
+
+    Block block(-1, "", true);
+    LeafId leaf = p.positionMap.getPosition(blockId);
+    if (leaf != -1) {
+        for (NodeIndex idx : p.tree.getPathIndices(leaf)) {
+            Block found = p.tree.takeBlock(idx, blockId);
+            if (found.id != -1) block = found;
+        }
+        p.positionMap.removePosition(blockId);
+    }
+
+    // A block that did not fit back into its path on the last eviction waits in the stash
+    Block stashed = p.stash.fetchBlock(blockId);
+    if (block.id == -1) block = stashed;
+    return block;
+}
+
+bool PartitionedORAM::write(int blockId, const std::string& data) {
+    std::unique_lock route(routeMutex);
+    if (partitionOf.count(blockId)) return false;
+
+    int target = randomPartition();
+    placeBlock(*partitions[target], Block(blockId, data, false));
+    partitionOf[blockId] = target;
+    return true;
+}
+
+Block PartitionedORAM::read(int blockId) {
+    std::future<Block> result;
+    {
+        std::shared_lock route(routeMutex);
+        auto it = partitionOf.find(blockId);
+        // Unknown blocks still cost a read on a random partition so they look like any other access
+        int target = (it != partitionOf.end()) ? it->second : randomPartition();
+
+        // Pin the block before letting go of the route, so a reshuffle does not move it mid-read
+        {
+            std::lock_guard<std::mutex> lock(pinMutex);
+            ++pinnedReads[blockId];
+        }
+
+        Partition& p = *partitions[target];
+        Request request{blockId, std::promise<Block>()};
+        result = request.result.get_future();
+        {
+            std::lock_guard<std::mutex> lock(p.queueMutex);
+            p.queue.push_back(std::move(request));
+        }
+        p.queueCv.notify_one();
+    }
+
+    Block block = result.get();
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        auto pin = pinnedReads.find(blockId);
+        if (--pin->second == 0) pinnedReads.erase(pin);
+    }
+    if (block.id != -1) {
+        std::lock_guard<std::mutex> lock(touchedMutex);
+        touchedBlocks.push_back(blockId);
+    }
+
+    if (++readsSinceReshuffle % reshuffleInterval == 0) {
+        reshuffle();
+    }
+    return block;
+}
+
+void PartitionedORAM::reshuffle() {
+    std::unique_lock route(routeMutex);
+
+    std::vector<int> touched;
+    {
+        std::lock_guard<std::mutex> lock(touchedMutex);
+        touched.swap(touchedBlocks);
+    }
+
+    std::vector<int> deferred; // still being read, moved by a later reshuffle
+    for (int blockId : touched) {
+        auto it = partitionOf.find(blockId);
+        if (it == partitionOf.end()) continue;
+
+        {
+            std::lock_guard<std::mutex> lock(pinMutex);
+            if (pinnedReads.count(blockId)) {
+                deferred.push_back(blockId);
+                continue;
+            }
+        }
+
+        int target = randomPartition();
+        if (target == it->second) continue;
+
+        Block block = takeBlock(*partitions[it->second], blockId);
+        if (block.id == -1) continue;
+
+        placeBlock(*partitions[target], block);
+        it->second = target;
+        ++movedBlocks;
+    }
+
+    if (!deferred.empty()) {
+        std::lock_guard<std::mutex> lock(touchedMutex);
+        touchedBlocks.insert(touchedBlocks.end(), deferred.begin(), deferred.end());
+    }
+    ++reshuffleCount;
+}
+
+int PartitionedORAM::getPartitionCount() const {
+    return static_cast<int>(partitions.size());
+}
+
+void PartitionedORAM::printStats() const {
+    std::shared_lock route(routeMutex);
+
+    std::cout << "\n[Partitioned ORAM] " << partitions.size() << " partitions, "
+              << partitionOf.size() << " blocks\n";
+    for (size_t i = 0; i < partitions.size(); ++i) {
+        std::cout << "  Partition " << i << ": " << partitions[i]->served.load() << " queries served\n";
+    }
+    std::cout << "  Reshuffles: " << reshuffleCount.load()
+              << ", blocks moved between partitions: " << movedBlocks.load() << "\n";
+}
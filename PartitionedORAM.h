@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ORAMTree.h"
+#include "PositionMap.h"
+#include "Stash.h"
+#include "DRLogSet.h"
+#include "QueryLog.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// P independent sub-ORAMs, each with its own tree, stash, logs and locks, served by a worker
+// thread pinned to its own core. Blocks are routed through a secret random block -> partition
+// map; every reshuffleInterval reads, the blocks read since the last reshuffle are moved to
+// freshly drawn partitions so that repeated accesses do not keep hitting the same partition.
+// Interval 1 moves every block right after it is read. With a larger interval, a block read
+// again before the next reshuffle visibly goes to the same partition as before; that is the
+// leak traded for fewer moves. The interval must be at least 1.
+class PartitionedORAM {
+private:
+    struct Request {
+        int blockId;
+        std::promise<Block> result;
+    };
+
+    struct Partition {
+        ORAMTree tree;
+        PositionMap positionMap;
+        Stash stash;
+        DRLogSet drl;
+        QueryLog qlog;
+
+        std::mutex queueMutex;
+        std::condition_variable queueCv;
+        std::deque<Request> queue;
+        bool stopping = false;
+        std::thread worker;
+        std::atomic<long long> served{0};
+
+        Partition(int depth, int c, bool sparse) : tree(depth, 0, sparse), drl(c), qlog(c) {}
+    };
+
+    std::vector<std::unique_ptr<Partition>> partitions;
+    std::unordered_map<int, int> partitionOf; // block ID -> partition, never leaves the client
+    mutable std::shared_mutex routeMutex;     // shared by reads, exclusive for writes and reshuffles
+
+    // Reads in flight per block. A reshuffle leaves pinned blocks where they are until a later
+    // reshuffle, so a read can let go of the route while it waits for its partition.
+    std::unordered_map<int, int> pinnedReads;
+    std::mutex pinMutex;
+
+    int reshuffleInterval;
+    std::vector<int> touchedBlocks; // read since the last reshuffle
+    std::mutex touchedMutex;
+    std::atomic<long long> readsSinceReshuffle{0};
+    std::atomic<long long> reshuffleCount{0};
+    std::atomic<long long> movedBlocks{0};
+
+    void workerLoop(Partition& p);
+    int randomPartition() const;
+    void placeBlock(Partition& p, const Block& block);
+    Block takeBlock(Partition& p, int blockId);
+
+public:
+    PartitionedORAM(int numPartitions, int depth, int c, int reshuffleInterval, bool sparse = false);
+    ~PartitionedORAM();
+
+    bool write(int blockId, const std::string& data); // false if the block already exists
+    Block read(int blockId);
+    void reshuffle();
+
+    int getPartitionCount() const;
+    void printStats() const;
+};
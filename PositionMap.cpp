@@ -1,20 +1,27 @@
 #include "PositionMap.h"
 #include <mutex>  // Required for std::unique_lock and std::shared_mutex    
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include "Serialization.h"
 
 using namespace std;
-void PositionMap::updatePosition(int blockId, int path) {
+void PositionMap::updatePosition(int blockId, LeafId path) {
     std::unique_lock lock(posMutex);
     positionMap[blockId] = path;
 }
 
-int PositionMap::getPosition(int blockId) const {
+LeafId PositionMap::getPosition(int blockId) const {
     std::shared_lock lock(posMutex);
     auto it = positionMap.find(blockId);
-    cout << "PositionMap::getPosition: blockId = " << blockId << endl;
     return (it != positionMap.end()) ? it->second : -1; // it->second is the path
 }
 
+void PositionMap::removePosition(int blockId) {
+    std::unique_lock lock(posMutex);
+    positionMap.erase(blockId);
+}
+
 void PositionMap::printMap() const {
     std::shared_lock lock(posMutex);
 
@@ -28,3 +35,48 @@ void PositionMap::printMap() const {
         std::cout << "  Block ID: " << blockId << " → Path: " << path << "\n";
     }
 }
+
+
+void PositionMap::serialize(std::ostream& out) const {
+    std::shared_lock lock(posMutex);
+    // Written in block ID order so that two snapshots of the same map are byte-identical
+    std::vector<std::pair<int, LeafId>> entries(positionMap.begin(), positionMap.end());
+    std::sort(entries.begin(), entries.end());
+
+    writePod(out, static_cast<uint64_t>(entries.size()));
+    for (const auto& [blockId, path] : entries) {
+        writePod(out, static_cast<int32_t>(blockId));
+        writePod(out, static_cast<int64_t>(path));
+    }
+}
+
+bool PositionMap::deserialize(std::istream& in, uint32_t formatVersion) {
+    uint64_t count = 0;
+    if (!readPod(in, count)) return false;
+
+    std::unordered_map<int, LeafId> restored;
+    restored.reserve(count < 4096 ? count : 4096); // the count comes from the file, do not trust it
+    for (uint64_t i = 0; i < count; ++i) {
+        int32_t blockId = 0;
+        int64_t path = 0;
+        if (!readPod(in, blockId)) return false;
+        if (formatVersion >= 2) {
+            if (!readPod(in, path)) return false;
+        } else {
+            int32_t narrowPath = 0; // v1 leaf IDs are 32-bit
+            if (!readPod(in, narrowPath)) return false;
+            path = narrowPath;
+        }
+        restored[blockId] = path;
+    }
+
+    std::unique_lock lock(posMutex);
+    positionMap = std::move(restored);
+    return true;
+}
+
+void PositionMap::restoreFrom(PositionMap& parsed) {
+    std::scoped_lock lock(posMutex, parsed.posMutex);
+    positionMap = std::move(parsed.positionMap);
+    parsed.positionMap.clear();
+}
@@ -2,15 +2,23 @@
 
 #include <unordered_map>
 #include <shared_mutex>
+#include <iosfwd>
+#include <cstdint>
+#include "TreeGeometry.h" // LeafId
 
 class PositionMap {
 private:
-    std::unordered_map<int, int> positionMap;
+    std::unordered_map<int, LeafId> positionMap;
     mutable std::shared_mutex posMutex;
 
 public:
-    void updatePosition(int blockId, int path);
-    int getPosition(int blockId) const;
+    void updatePosition(int blockId, LeafId path);
+    LeafId getPosition(int blockId) const; // -1 if the block is not mapped
+    void removePosition(int blockId);
     void printMap() const;
 
+    void serialize(std::ostream& out) const;
+    bool deserialize(std::istream& in, uint32_t formatVersion);
+    void restoreFrom(PositionMap& parsed); // takes over the state of one just deserialized
+
 };
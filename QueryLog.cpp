@@ -2,22 +2,133 @@
 #include <algorithm>
 
 #include <iostream>
-std::pair<int, bool> QueryLog::registerQuery(int blockId) {
+#include "Serialization.h"
+
+QueryLog::QueryLog(int roundSize) : roundSize(roundSize), nextRoundSize(roundSize) {}
+
+QueryTicket QueryLog::registerQuery(int blockId) {
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    // Overlaps are checked against every round still held, not only the open one
+    QueryTicket ticket;
+    for (const auto& [number, round] : rounds) {
+        if (blockId == kPaddingBlockId) break;
+        auto it = std::find(round.blockIds.rbegin(), round.blockIds.rend(), blockId);
+        if (it != round.blockIds.rend()) {
+            ticket.overlap = true;
+            ticket.overlapRound = number; // rounds are in order, so the last match is the latest
+            ticket.overlapQueryId = static_cast<int>(round.blockIds.rend() - it - 1);
+        }
+    }
+
+    Round& round = rounds[openRound];
+    if (round.blockIds.empty()) round.opened = Clock::now();
+    round.blockIds.push_back(blockId);
+    round.done.push_back(false);
+    ++round.inFlight;
+    ticket.round = openRound;
+    ticket.queryId = static_cast<int>(round.blockIds.size() - 1);
+
+    if (roundSize > 0 && static_cast<int>(round.blockIds.size()) >= roundSize) {
+        sealOpenRoundLocked();
+    }
+    return ticket;
+}
+
+void QueryLog::sealOpenRoundLocked() {
+    rounds[openRound].sealed = true;
+    ++openRound;
+    ++sealedRounds;
+    roundSize = nextRoundSize;
+}
+
+long long QueryLog::dropIfDrainedLocked(long long round) {
+    auto it = rounds.find(round);
+    if (it == rounds.end() || !it->second.sealed || it->second.inFlight > 0) return -1;
+    rounds.erase(it);
+    return round;
+}
+
+long long QueryLog::completeQuery(const QueryTicket& ticket) {
+    long long drained = -1;
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        auto it = rounds.find(ticket.round);
+        if (it == rounds.end()) return -1;
+        it->second.done[ticket.queryId] = true;
+        --it->second.inFlight;
+        drained = dropIfDrainedLocked(ticket.round);
+    }
+    completionCv.notify_all();
+    return drained;
+}
+
+void QueryLog::waitForOverlapped(const QueryTicket& ticket) {
+    if (!ticket.overlap) return;
+
+    std::unique_lock<std::mutex> lock(logMutex);
+    completionCv.wait(lock, [&] {
+        auto it = rounds.find(ticket.overlapRound);
+        return it == rounds.end() || it->second.done[ticket.overlapQueryId]; // a dropped round has drained
+    });
+}
+
+bool QueryLog::sealOpenRound(double minAgeMs, long long& drainedRound) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    drainedRound = -1;
+
+    auto it = rounds.find(openRound);
+    if (it == rounds.end() || it->second.blockIds.empty()) return false;
+    double openMs = std::chrono::duration<double, std::milli>(Clock::now() - it->second.opened).count();
+    if (openMs < minAgeMs) return false;
+
+    long long sealed = openRound;
+    sealOpenRoundLocked();
+    drainedRound = dropIfDrainedLocked(sealed);
+    return true;
+}
+
+long long QueryLog::setRoundSize(int c) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    nextRoundSize = c;
+    auto it = rounds.find(openRound);
+    if (it == rounds.end() || it->second.blockIds.empty()) {
+        roundSize = c; // nobody in the open round yet
+        return openRound;
+    }
+    return openRound + 1;
+}
+
+int QueryLog::getRoundSize() const {
     std::lock_guard<std::mutex> lock(logMutex);
+    return roundSize;
+}
 
-    bool overlap = (std::find(log.begin(), log.end(), blockId) != log.end());
-    log.push_back(blockId);
-    return {static_cast<int>(log.size() - 1), overlap}; // index, overlap
+long long QueryLog::getSealedRoundCount() const {
+    std::lock_guard<std::mutex> lock(logMutex);
+    return sealedRounds;
 }
 
-void QueryLog::clear() {
+int QueryLog::getInFlight() const {
     std::lock_guard<std::mutex> lock(logMutex);
-    log.clear();
+    int inFlight = 0;
+    for (const auto& [number, round] : rounds) inFlight += round.inFlight;
+    return inFlight;
+}
+
+std::shared_lock<std::shared_mutex> QueryLog::enterQuery() const {
+    return std::shared_lock<std::shared_mutex>(quiesceMutex);
+}
+
+std::unique_lock<std::shared_mutex> QueryLog::quiesce() const {
+    return std::unique_lock<std::shared_mutex>(quiesceMutex);
 }
 
 size_t QueryLog::size() {
     std::lock_guard<std::mutex> lock(logMutex);
-    return log.size();
+    size_t entries = 0;
+    for (const auto& [number, round] : rounds) entries += round.blockIds.size();
+    return entries;
 }
 
 
@@ -26,12 +137,65 @@ void QueryLog::printLog() const {
     std::lock_guard<std::mutex> lock(logMutex);
 
     std::cout << "\n[QueryLog Contents]\n";
-    if (log.empty()) {
+    if (rounds.empty()) {
         std::cout << "(Log is empty)\n";
         return;
     }
 
-    for (size_t i = 0; i < log.size(); ++i) {
-        std::cout << "  Query " << i << ": Block ID = " << log[i] << "\n";
+    for (const auto& [number, round] : rounds) {
+        std::cout << "  Round " << number << (round.sealed ? " (sealed, " : " (open, ")
+                  << round.inFlight << " running)\n";
+        for (size_t i = 0; i < round.blockIds.size(); ++i) {
+            std::cout << "    Query " << i << ": Block ID = " << round.blockIds[i] << "\n";
+        }
+    }
+}
+
+
+// Snapshots are taken with no query running, so every sealed round has drained and only the
+// open round's entries are left; they come back as the open round
+void QueryLog::serialize(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(logMutex);
+    std::vector<int> log;
+    for (const auto& [number, round] : rounds) {
+        log.insert(log.end(), round.blockIds.begin(), round.blockIds.end());
+    }
+
+    writePod(out, static_cast<uint64_t>(log.size()));
+    for (int blockId : log) {
+        writePod(out, static_cast<int32_t>(blockId));
+    }
+}
+
+bool QueryLog::deserialize(std::istream& in) {
+    uint64_t count = 0;
+    if (!readPod(in, count)) return false;
+
+    std::vector<int> restored;
+    for (uint64_t i = 0; i < count; ++i) {
+        int32_t blockId = 0;
+        if (!readPod(in, blockId)) return false;
+        restored.push_back(blockId);
+    }
+
+    std::lock_guard<std::mutex> lock(logMutex);
+    rounds.clear();
+    openRound = 0; // DRLogSet::deserialize puts its open entries into round 0 as well
+    if (!restored.empty()) {
+        Round& round = rounds[openRound];
+        round.blockIds = std::move(restored);
+        round.done.assign(round.blockIds.size(), true); // taken with no query running
+        round.opened = Clock::now();
+    }
+    return true;
+}
+
+void QueryLog::restoreFrom(QueryLog& parsed) {
+    {
+        std::scoped_lock lock(logMutex, parsed.logMutex);
+        rounds = std::move(parsed.rounds);
+        openRound = parsed.openRound;
+        parsed.rounds.clear();
     }
+    completionCv.notify_all();
 }
@@ -1,24 +1,93 @@
 #pragma once
 
 #include <vector>
+#include <map>
 #include <mutex>
+#include <condition_variable>
+#include <shared_mutex>
+#include <chrono>
+#include <iosfwd>
 
+// Where a query landed in the log: its round, its slot in that round, and whether an earlier
+// query of the same block is still in the log
+struct QueryTicket {
+    long long round = 0;
+    int queryId = 0;
+    bool overlap = false;
+    long long overlapRound = 0; // the latest earlier query of the block, when overlap is set
+    int overlapQueryId = 0;
+};
+
+// Owns the query rounds. A round seals once c queries have registered (or when it is sealed
+// early, at the scheduler's deadline), whether or not they have finished; later queries go into
+// the next round. A sealed round's entries stay in the log, and keep catching overlaps, until
+// its own queries have all completed. The round numbers handed out here are the ones the
+// DRLogSet keys its rounds by.
 class QueryLog {
 private:
-    std::vector<int> log;
+    using Clock = std::chrono::steady_clock;
+
+    struct Round {
+        std::vector<int> blockIds; // by query ID
+        std::vector<bool> done;    // by query ID
+        int inFlight = 0;
+        bool sealed = false;
+        Clock::time_point opened;  // first registration
+    };
+
+    std::map<long long, Round> rounds; // the open round and sealed rounds still draining
+    long long openRound = 0;
+    int roundSize;                     // c of the open round, 0 = only sealed explicitly
+    int nextRoundSize;
+    long long sealedRounds = 0;
     mutable std::mutex logMutex;
+    std::condition_variable completionCv;
+
+    // Held shared for the whole of every query and round transition, and exclusively by
+    // snapshot and restore, so that those see all structures at one consistent cut
+    mutable std::shared_mutex quiesceMutex;
 
+    void sealOpenRoundLocked();
+    long long dropIfDrainedLocked(long long round); // the round if it was dropped, -1 otherwise
 
 public:
-    // Register a block ID, return index (query ID), and overlap status
-    std::pair<int, bool> registerQuery(int blockId);
+    // Registered by padding queries, so that they take a slot in their round like any other
+    // query; never reported as an overlap
+    static constexpr int kPaddingBlockId = -1;
+
+    explicit QueryLog(int roundSize = 0);
 
-    // Clear log (used after a round is complete)
-    void clear();
+    // Register a block ID in the open round; sealing it if this was query c
+    QueryTicket registerQuery(int blockId);
 
-    size_t size();
+    // Marks the query finished. Returns its round if that drained a sealed round, which is then
+    // due to be finalized in the DRLogSet; -1 otherwise
+    long long completeQuery(const QueryTicket& ticket);
+
+    // Blocks until the query this one overlaps with has completed, i.e. has written its result to
+    // the DR-LogSet. Returns at once when that query is already done, e.g. on a serial worker.
+    void waitForOverlapped(const QueryTicket& ticket);
+
+    // Seals the open round if it has queries and was opened at least minAgeMs ago. A round that
+    // has no queries left running is drained right away and returned in drainedRound (else -1)
+    bool sealOpenRound(double minAgeMs, long long& drainedRound);
+
+    long long setRoundSize(int c); // returns the first round it applies to: the next one, or the
+                                   // open round while that is still empty
+    int getRoundSize() const;
+    long long getSealedRoundCount() const;
+    int getInFlight() const;
+
+    size_t size(); // entries still held, over all rounds
 
     void printLog() const;
 
+    std::shared_lock<std::shared_mutex> enterQuery() const;
+    std::unique_lock<std::shared_mutex> quiesce() const; // waits for running queries to finish
+
+    void serialize(std::ostream& out) const;
+    bool deserialize(std::istream& in);
+    void restoreFrom(QueryLog& parsed); // takes over the state of one just deserialized
+
 
 };
@@ -0,0 +1,74 @@
+#include "Random.h"
+#include <atomic>
+#include <mutex>
+
+static std::mutex seedMutex;
+static bool seeded = false;
+static uint64_t globalSeed = 0;
+static std::atomic<uint64_t> seedGeneration{0}; // bumped on every setGlobalSeed
+static std::atomic<uint64_t> threadsSeeded{0};  // threads that derived an engine in this generation
+
+void setGlobalSeed(uint64_t seed) {
+    std::lock_guard<std::mutex> lock(seedMutex);
+    globalSeed = seed;
+    seeded = true;
+    threadsSeeded = 0;
+    ++seedGeneration;
+}
+
+bool hasGlobalSeed() {
+    std::lock_guard<std::mutex> lock(seedMutex);
+    return seeded;
+}
+
+uint64_t getGlobalSeed() {
+    std::lock_guard<std::mutex> lock(seedMutex);
+    return globalSeed;
+}
+
+namespace {
+
+struct ThreadEngine {
+    std::mt19937_64 engine;
+    uint64_t generation = ~0ULL; // seed generation the engine was derived in
+};
+
+ThreadEngine& threadEngine() {
+    thread_local ThreadEngine state;
+    return state;
+}
+
+} // namespace
+
+void seedRandomStream(uint64_t stream) {
+    ThreadEngine& state = threadEngine();
+    std::lock_guard<std::mutex> lock(seedMutex);
+    if (!seeded) return;
+
+    // seed_seq keeps 32 bits per value; the longer sequence keeps streams apart from the
+    // per-thread sequences below
+    std::seed_seq seq{static_cast<uint32_t>(globalSeed), static_cast<uint32_t>(globalSeed >> 32),
+                      static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)};
+    state.engine.seed(seq);
+    state.generation = seedGeneration.load();
+}
+
+std::mt19937_64& randomEngine() {
+    ThreadEngine& state = threadEngine();
+
+    uint64_t generation = seedGeneration.load();
+    if (state.generation != generation) {
+        std::lock_guard<std::mutex> lock(seedMutex);
+        if (seeded) {
+            // Split the seed as seedRandomStream does; seed_seq would drop its upper 32 bits
+            uint64_t thread = threadsSeeded++;
+            std::seed_seq seq{static_cast<uint32_t>(globalSeed), static_cast<uint32_t>(globalSeed >> 32),
+                              static_cast<uint32_t>(thread)};
+            state.engine.seed(seq);
+        } else {
+            state.engine.seed(std::random_device{}());
+        }
+        state.generation = generation;
+    }
+    return state.engine;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+// Every random choice in the ORAM (leaf remapping, dummy paths, log and stash shuffles,
+// partition routing, benchmarks) draws from randomEngine(). By default it is seeded from
+// std::random_device; after setGlobalSeed(s) each thread's engine is derived from s and the
+// order in which threads first use it. Code that must not depend on that order (trace replay)
+// reseeds the calling thread's engine with seedRandomStream before each unit of work.
+
+void setGlobalSeed(uint64_t seed);
+bool hasGlobalSeed();
+uint64_t getGlobalSeed();
+
+// Reseeds this thread's engine from the global seed and the given stream number, so the draws
+// that follow depend only on (seed, stream). No-op unless a global seed is set.
+void seedRandomStream(uint64_t stream);
+
+// Per-thread engine; reseeds itself when setGlobalSeed is called again
+std::mt19937_64& randomEngine();
@@ -0,0 +1,254 @@
+#include "RingORAM.h"
+#include "Random.h"
+#include <algorithm>
+#include <iostream>
+
+RingORAM::RingORAM(int depth, PositionMap& positionMap, Stash& stash, RingPolicy policy)
+    : depth(depth), policy(policy), positionMap(positionMap), stash(stash)
+{
+    buckets.resize(static_cast<size_t>(Geometry::nodeCount(depth)));
+    for (RingBucket& bucket : buckets) {
+        resetBucket(bucket);
+    }
+}
+
+void RingORAM::resetBucket(RingBucket& bucket) {
+    int slotCount = policy.Z + policy.S;
+    bucket.slots.assign(slotCount, Block(-1, "", true));
+    bucket.slotBlockId.assign(slotCount, -1);
+    bucket.valid.assign(slotCount, true);
+    bucket.readCount = 0;
+}
+
+std::vector<NodeIndex> RingORAM::pathIndices(LeafId leaf) const {
+    std::vector<NodeIndex> path(depth + 1);
+    NodeIndex index = Geometry::leafIndex(leaf, depth);
+    for (int level = depth; level >= 0; --level) {
+        path[level] = index;
+        index = Geometry::parent(index);
+    }
+    return path; // root to leaf
+}
+
+bool RingORAM::onPath(NodeIndex node, int level, LeafId leaf) const {
+    NodeIndex index = Geometry::leafIndex(leaf, depth);
+    for (int l = depth; l > level; --l) index = Geometry::parent(index);
+    return index == node;
+}
+
+// One slot per bucket: the block itself where the metadata says it is, an unread dummy elsewhere
+Block RingORAM::readPath(LeafId leaf, int blockId) {
+    Block found(-1, "", true);
+
+    for (NodeIndex node : pathIndices(leaf)) {
+        RingBucket& bucket = buckets[node];
+
+        int slot = -1;
+        std::vector<int> dummies;
+        for (int i = 0; i < static_cast<int>(bucket.slots.size()); ++i) {
+            if (!bucket.valid[i]) continue;
+            if (bucket.slotBlockId[i] == blockId && blockId != -1) slot = i;
+            else if (bucket.slotBlockId[i] == -1) dummies.push_back(i);
+        }
+        if (slot == -1) {
+            if (dummies.empty()) continue; // cannot happen while early reshuffles keep up
+            slot = dummies[std::uniform_int_distribution<size_t>(0, dummies.size() - 1)(randomEngine())];
+        }
+
+        bucket.valid[slot] = false;
+        ++bucket.readCount;
+        ++onlineBlockReads;
+
+        if (bucket.slotBlockId[slot] != -1) {
+            found = std::move(bucket.slots[slot]);
+            bucket.slots[slot] = Block(-1, "", true);
+            bucket.slotBlockId[slot] = -1;
+        }
+    }
+    return found;
+}
+
+void RingORAM::readBucketIntoStash(RingBucket& bucket) {
+    for (int i = 0; i < static_cast<int>(bucket.slots.size()); ++i) {
+        if (bucket.valid[i] && bucket.slotBlockId[i] != -1) {
+            stash.addBlock(bucket.slots[i]);
+        }
+    }
+    evictionBlockReads += policy.Z; // Z slots are fetched, real blocks padded with dummies
+}
+
+// Refills a bucket with up to Z stash blocks whose path runs through it, then re-permutes it
+void RingORAM::writeBucket(NodeIndex node, int level) {
+    std::vector<Block> chosen;
+    stash.evict([&](const Block& b) {
+        if (static_cast<int>(chosen.size()) >= policy.Z) return false;
+        LeafId leaf = positionMap.getPosition(b.id);
+        if (leaf == -1 || !onPath(node, level, leaf)) return false;
+        chosen.push_back(b);
+        return true;
+    });
+
+    RingBucket& bucket = buckets[node];
+    resetBucket(bucket);
+    for (size_t i = 0; i < chosen.size(); ++i) {
+        bucket.slotBlockId[i] = chosen[i].id;
+        bucket.slots[i] = std::move(chosen[i]);
+    }
+
+    std::vector<int> order(bucket.slots.size());
+    for (int i = 0; i < static_cast<int>(order.size()); ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), randomEngine());
+
+    std::vector<Block> slots(bucket.slots.size());
+    std::vector<int> ids(bucket.slots.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        slots[i] = std::move(bucket.slots[order[i]]);
+        ids[i] = bucket.slotBlockId[order[i]];
+    }
+    bucket.slots = std::move(slots);
+    bucket.slotBlockId = std::move(ids);
+
+    bucketWrites += policy.Z + policy.S;
+}
+
+void RingORAM::evictPath(LeafId leaf) {
+    std::vector<NodeIndex> path = pathIndices(leaf);
+    for (NodeIndex node : path) {
+        readBucketIntoStash(buckets[node]);
+    }
+    for (int level = depth; level >= 0; --level) {
+        writeBucket(path[level], level);
+    }
+    ++evictions;
+}
+
+void RingORAM::earlyReshuffle(LeafId leaf) {
+    std::vector<NodeIndex> path = pathIndices(leaf);
+    for (int level = 0; level <= depth; ++level) {
+        RingBucket& bucket = buckets[path[level]];
+        if (bucket.readCount >= policy.S) {
+            readBucketIntoStash(bucket);
+            writeBucket(path[level], level);
+            ++earlyReshuffles;
+        }
+    }
+}
+
+// Reverse-lexicographic order: the bit-reversed eviction counter, so consecutive evictions
+// spread over the tree and every bucket on a level is evicted equally often
+LeafId RingORAM::nextEvictionLeaf() {
+    LeafId g = evictionCounter++ % Geometry::leafCount(depth);
+    LeafId reversed = 0;
+    for (int bit = 0; bit < depth; ++bit) {
+        reversed = (reversed << 1) | ((g >> bit) & 1);
+    }
+    return reversed;
+}
+
+void RingORAM::afterAccess(LeafId leaf) {
+    if (++accessCount % policy.A == 0) {
+        evictPath(nextEvictionLeaf());
+    }
+    earlyReshuffle(leaf);
+}
+
+Block RingORAM::access(int blockId) {
+    std::lock_guard<std::mutex> lock(ringMutex);
+
+    LeafId leaf = positionMap.getPosition(blockId);
+    bool mapped = (leaf != -1);
+    if (!mapped) leaf = std::uniform_int_distribution<LeafId>(0, getLeafCount() - 1)(randomEngine());
+
+    Block result = readPath(leaf, mapped ? blockId : -1);
+    if (result.id == -1 && mapped) {
+        result = stash.fetchBlock(blockId); // evicted blocks may still be waiting in the stash
+    }
+
+    if (result.id != -1) {
+        positionMap.updatePosition(blockId, std::uniform_int_distribution<LeafId>(0, getLeafCount() - 1)(randomEngine()));
+        stash.addBlock(result);
+    }
+
+    afterAccess(leaf);
+    return result;
+}
+
+void RingORAM::dummyAccess() {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    LeafId leaf = std::uniform_int_distribution<LeafId>(0, getLeafCount() - 1)(randomEngine());
+    readPath(leaf, -1);
+    afterAccess(leaf);
+}
+
+void RingORAM::writeBlock(int blockId, const std::string& data, LeafId leaf) {
+    std::lock_guard<std::mutex> lock(ringMutex);
+
+    // A block written again replaces its old copy, which sits on its old path or in the stash
+    LeafId oldLeaf = positionMap.getPosition(blockId);
+    if (oldLeaf != -1) {
+        stash.fetchBlock(blockId);
+        for (NodeIndex node : pathIndices(oldLeaf)) {
+            RingBucket& bucket = buckets[node];
+            for (int i = 0; i < static_cast<int>(bucket.slots.size()); ++i) {
+                if (bucket.slotBlockId[i] != blockId) continue;
+                bucket.slots[i] = Block(-1, "", true);
+                bucket.slotBlockId[i] = -1;
+            }
+        }
+    }
+    positionMap.updatePosition(blockId, leaf);
+
+    // Deepest bucket on the path with a free real slot; the stash if the path is full
+    std::vector<NodeIndex> path = pathIndices(leaf);
+    for (int level = depth; level >= 0; --level) {
+        RingBucket& bucket = buckets[path[level]];
+        int real = static_cast<int>(std::count_if(bucket.slotBlockId.begin(), bucket.slotBlockId.end(),
+                                                  [](int id) { return id != -1; }));
+        if (real >= policy.Z) continue;
+
+        std::vector<int> free;
+        for (int i = 0; i < static_cast<int>(bucket.slots.size()); ++i) {
+            if (bucket.valid[i] && bucket.slotBlockId[i] == -1) free.push_back(i);
+        }
+        if (free.empty()) continue;
+
+        int slot = free[std::uniform_int_distribution<size_t>(0, free.size() - 1)(randomEngine())];
+        bucket.slots[slot] = Block(blockId, data, false);
+        bucket.slotBlockId[slot] = blockId;
+        return;
+    }
+    stash.addBlock(Block(blockId, data, false));
+}
+
+LeafId RingORAM::getLeafCount() const {
+    return Geometry::leafCount(depth);
+}
+
+long long RingORAM::getAccessCount() const {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    return accessCount;
+}
+
+long long RingORAM::getOnlineBlockReads() const {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    return onlineBlockReads;
+}
+
+long long RingORAM::getOfflineBlockTraffic() const {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    return evictionBlockReads + bucketWrites;
+}
+
+void RingORAM::printStats() const {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    std::cout << "\n[Ring ORAM] Z=" << policy.Z << " S=" << policy.S << " A=" << policy.A
+              << ", depth " << depth << "\n";
+    std::cout << "  Accesses: " << accessCount << ", evictions: " << evictions
+              << ", early reshuffles: " << earlyReshuffles << "\n";
+    if (accessCount > 0) {
+        std::cout << "  Online blocks read per access: " << static_cast<double>(onlineBlockReads) / accessCount
+                  << " (Path ORAM reads " << policy.Z * (depth + 1) << ")\n";
+        std::cout << "  Eviction/reshuffle blocks moved per access: "
+                  << static_cast<double>(evictionBlockReads + bucketWrites) / accessCount << "\n";
+    }
+}
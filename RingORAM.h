@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Block.h"
+#include "TreeGeometry.h"
+#include "PositionMap.h"
+#include "Stash.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct RingPolicy {
+    int Z = 4; // real slots per bucket
+    int S = 6; // dummy slots per bucket, i.e. reads a bucket absorbs before it must be reshuffled
+    int A = 3; // one eviction every A accesses
+};
+
+// Ring ORAM style access engine on a binary tree. Every bucket holds Z + S randomly permuted
+// slots plus client-side metadata (which block sits in which slot, which slots were already
+// read). A query therefore reads exactly one slot per bucket on its path: the wanted block if
+// the bucket holds it, an unread dummy otherwise. Every A accesses one path is evicted, in
+// reverse-lexicographic order of leaves; a bucket that has served S reads is reshuffled early.
+// Shares the PositionMap and Stash with the rest of the system. Buckets are allocated densely,
+// so the tree depth is limited to kMaxDepth, and they are not part of snapshots.
+class RingORAM {
+private:
+    using Geometry = TreeGeometry<2>;
+
+    struct RingBucket {
+        std::vector<Block> slots;
+        std::vector<int> slotBlockId; // metadata: block ID per slot, -1 for a dummy
+        std::vector<bool> valid;      // slot not read since the bucket was last written
+        int readCount = 0;
+    };
+
+    int depth;
+    RingPolicy policy;
+    PositionMap& positionMap;
+    Stash& stash;
+    std::vector<RingBucket> buckets;
+    mutable std::mutex ringMutex; // one access at a time: metadata and eviction order are shared
+
+    long long accessCount = 0;
+    long long evictionCounter = 0; // G, the reverse-lexicographic eviction position
+
+    // Bandwidth in blocks
+    long long onlineBlockReads = 0;
+    long long evictionBlockReads = 0;
+    long long bucketWrites = 0;
+    long long evictions = 0;
+    long long earlyReshuffles = 0;
+
+    std::vector<NodeIndex> pathIndices(LeafId leaf) const;
+    bool onPath(NodeIndex node, int level, LeafId leaf) const;
+    void resetBucket(RingBucket& bucket);
+
+    Block readPath(LeafId leaf, int blockId);
+    void readBucketIntoStash(RingBucket& bucket);
+    void writeBucket(NodeIndex node, int level);
+    void evictPath(LeafId leaf);
+    void earlyReshuffle(LeafId leaf);
+    void afterAccess(LeafId leaf);
+    LeafId nextEvictionLeaf();
+
+public:
+    static constexpr int kMaxDepth = 16; // 2^17 - 1 buckets of Z + S slots each
+
+    RingORAM(int depth, PositionMap& positionMap, Stash& stash, RingPolicy policy = RingPolicy());
+
+    Block access(int blockId); // read, remap, and evict when due
+    void dummyAccess();        // same server-visible pattern as access() on a random path
+    void writeBlock(int blockId, const std::string& data, LeafId leaf); // replaces an earlier write
+
+    LeafId getLeafCount() const;
+    long long getAccessCount() const;
+    long long getOnlineBlockReads() const;
+    long long getOfflineBlockTraffic() const; // eviction and reshuffle reads plus bucket writes
+    void printStats() const;
+};
@@ -0,0 +1,128 @@
+#include "RoundScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Weight of the newest sample in the moving averages
+static const double kSmoothing = 0.2;
+
+RoundScheduler::RoundScheduler(DRLogSet& drl, StashSet& stashSet, QueryLog& qlog, RoundPolicy policy)
+    : drl(drl), stashSet(stashSet), qlog(qlog), policy(policy)
+{
+    roundC = std::clamp(drl.getRoundSize(), policy.minC, policy.maxC);
+    drl.setRoundSize(roundC, qlog.setRoundSize(roundC));
+    stashSet.resize(policy.maxC); // one stash per query slot of the largest round, never shrunk
+    adaptedAtRound = qlog.getSealedRoundCount();
+    sealer = std::thread(&RoundScheduler::sealerLoop, this);
+}
+
+RoundScheduler::~RoundScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(schedMutex);
+        stopping = true;
+    }
+    stopCv.notify_one();
+    sealer.join();
+}
+
+void RoundScheduler::recordArrival() {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    Clock::time_point now = Clock::now();
+
+    if (seenArrival) {
+        double gapMs = std::chrono::duration<double, std::milli>(now - lastArrival).count();
+        avgGapMs = (avgGapMs == 0) ? gapMs : (1 - kSmoothing) * avgGapMs + kSmoothing * gapMs;
+    }
+    lastArrival = now;
+    seenArrival = true;
+}
+
+void RoundScheduler::recordCompletion(double latencyMs) {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    avgLatencyMs = (avgLatencyMs == 0) ? latencyMs : (1 - kSmoothing) * avgLatencyMs + kSmoothing * latencyMs;
+    if (pauseCount == 0) adaptLocked();
+}
+
+void RoundScheduler::pause() {
+    std::unique_lock<std::mutex> lock(schedMutex);
+    ++pauseCount;
+    sealedCv.wait(lock, [this] { return !sealing; });
+}
+
+void RoundScheduler::resume() {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    if (pauseCount > 0 && --pauseCount == 0) {
+        adaptedAtRound = qlog.getSealedRoundCount(); // rounds sealed while paused were not ours
+    }
+}
+
+void RoundScheduler::adaptLocked() {
+    // c is picked once per sealed round
+    long long sealed = qlog.getSealedRoundCount();
+    if (sealed == adaptedAtRound) return;
+    adaptedAtRound = sealed;
+
+    // Queries expected to arrive within the latency target
+    int nextC = roundC; // no rate estimate yet after a single arrival
+    if (avgGapMs > 0) {
+        nextC = static_cast<int>(std::ceil(policy.latencyTargetMs / avgGapMs));
+    }
+    // Clients are already waiting longer than we want: use smaller rounds
+    if (avgLatencyMs > policy.latencyTargetMs) {
+        nextC = std::min(nextC, roundC - 1);
+    }
+    nextC = std::clamp(nextC, policy.minC, policy.maxC);
+
+    if (nextC != roundC) {
+        // Rounds already open or draining keep the c they were opened under
+        drl.setRoundSize(nextC, qlog.setRoundSize(nextC));
+        roundC = nextC;
+    }
+}
+
+void RoundScheduler::sealerLoop() {
+    auto tick = std::chrono::duration<double, std::milli>(policy.sealDeadlineMs / 4);
+
+    std::unique_lock<std::mutex> lock(schedMutex);
+    while (!stopCv.wait_for(lock, tick, [this] { return stopping; })) {
+        if (pauseCount > 0) continue;
+
+        // Nobody else is coming in time: seal what we have, running queries or not. It is padded
+        // and finalized in the DR-LogSet once its last query is done (right now if none is left).
+        sealing = true;
+        lock.unlock();
+        bool sealed;
+        {
+            auto active = qlog.enterQuery();
+            long long drained = -1;
+            sealed = qlog.sealOpenRound(policy.sealDeadlineMs, drained);
+            if (drained >= 0) drl.finalizeRound(drained);
+        }
+        lock.lock();
+        sealing = false;
+        sealedCv.notify_all();
+
+        if (sealed) {
+            ++sealedAtDeadline;
+            if (pauseCount == 0) adaptLocked();
+        }
+    }
+}
+
+int RoundScheduler::getRoundSize() const {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    return roundC;
+}
+
+void RoundScheduler::printStats() const {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    long long sealed = qlog.getSealedRoundCount();
+    std::cout << "\n[Round Scheduler]\n";
+    std::cout << "  Round size c: " << roundC << " (bounds " << policy.minC << " to " << policy.maxC << ")\n";
+    std::cout << "  Avg inter-arrival: " << avgGapMs << " ms, avg latency: " << avgLatencyMs
+              << " ms (target " << policy.latencyTargetMs << " ms)\n";
+    std::cout << "  Rounds sealed full: " << sealed - sealedAtDeadline
+              << ", sealed at the " << policy.sealDeadlineMs << " ms deadline: " << sealedAtDeadline << "\n";
+    if (pauseCount > 0) std::cout << "  Paused\n";
+    std::cout << "  Queries running: " << qlog.getInFlight() << ", log entries held: " << qlog.size() << "\n";
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "DRLogSet.h"
+#include "StashSet.h"
+#include "QueryLog.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct RoundPolicy {
+    int minC;                     // smallest round size the scheduler may pick
+    int maxC;                     // largest round size the scheduler may pick
+    double latencyTargetMs = 50;  // how long a query may wait for the peers in its round
+    double sealDeadlineMs = 200;  // a partial round is sealed once it has been open this long
+};
+
+// Decides the round size c at runtime and seals partial rounds. The QueryLog seals a round as
+// soon as c queries have registered, however many are still running; a round that has been open
+// for sealDeadlineMs without filling up is sealed here. Each round's DR-LogSet entries are
+// finalized when its last query completes. After every sealed round the next c is picked from
+// the observed arrival rate: by Little's law, the number of queries expected to arrive within
+// the latency target, clamped to [minC, maxC]. The new c applies to rounds opened after the
+// change; rounds already open or draining are still padded with the c they were opened under.
+class RoundScheduler {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    DRLogSet& drl;
+    StashSet& stashSet;
+    QueryLog& qlog;
+    RoundPolicy policy;
+
+    mutable std::mutex schedMutex;
+    std::condition_variable stopCv;
+    bool stopping = false;
+    std::thread sealer;
+
+    int pauseCount = 0;             // pause() calls not yet resumed
+    bool sealing = false;           // the sealer is sealing a round right now
+    std::condition_variable sealedCv;
+
+    int roundC;                     // c picked for the rounds being opened now
+    long long adaptedAtRound = 0;   // QueryLog sealed-round count when c was last picked
+    Clock::time_point lastArrival;
+    bool seenArrival = false;
+
+    double avgGapMs = 0;        // EWMA of inter-arrival time
+    double avgLatencyMs = 0;    // EWMA of query latency
+    long long sealedAtDeadline = 0;
+
+    void adaptLocked();
+    void sealerLoop();
+
+public:
+    RoundScheduler(DRLogSet& drl, StashSet& stashSet, QueryLog& qlog, RoundPolicy policy);
+    ~RoundScheduler();
+
+    void recordArrival();                   // before a query registers with the QueryLog
+    void recordCompletion(double latencyMs); // after the query returned
+
+    // While paused, neither deadlines nor c adaptation touch the rounds: they seal at c arrivals,
+    // or wherever the caller seals them. pause() returns once a seal in progress has finished.
+    void pause();
+    void resume();
+
+    int getRoundSize() const;
+    void printStats() const;
+};
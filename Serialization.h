@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Block.h"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Raw little-endian helpers shared by every structure that takes part in a snapshot
+
+template <typename T>
+void writePod(std::ostream& out, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "writePod needs a trivially copyable type");
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readPod(std::istream& in, T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "readPod needs a trivially copyable type");
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<bool>(in);
+}
+
+inline void writeString(std::ostream& out, const std::string& s) {
+    writePod(out, static_cast<uint64_t>(s.size()));
+    out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+// Bytes between the read position and the end of the stream
+inline bool bytesLeft(std::istream& in, uint64_t& left) {
+    std::streampos pos = in.tellg();
+    if (pos < 0 || !in.seekg(0, std::ios::end)) return false;
+    std::streampos end = in.tellg();
+    in.seekg(pos);
+    if (end < pos || !in) return false;
+    left = static_cast<uint64_t>(end - pos);
+    return true;
+}
+
+inline bool readString(std::istream& in, std::string& s) {
+    uint64_t len = 0;
+    if (!readPod(in, len)) return false;
+
+    // The length comes from the file: never allocate more than the stream can still deliver
+    uint64_t left = 0;
+    if (!bytesLeft(in, left) || len > left) {
+        in.setstate(std::ios::failbit);
+        return false;
+    }
+    s.resize(len);
+    in.read(&s[0], static_cast<std::streamsize>(len));
+    return static_cast<bool>(in);
+}
+
+inline void writeBlock(std::ostream& out, const Block& b) {
+    writePod(out, static_cast<int32_t>(b.id));
+    writePod(out, static_cast<uint8_t>(b.isDummy ? 1 : 0));
+    writeString(out, b.data);
+}
+
+inline bool readBlock(std::istream& in, Block& b) {
+    int32_t id = 0;
+    uint8_t dummy = 0;
+    if (!readPod(in, id) || !readPod(in, dummy) || !readString(in, b.data)) return false;
+    b.id = id;
+    b.isDummy = (dummy != 0);
+    return true;
+}
+
+inline void writeBlocks(std::ostream& out, const std::vector<Block>& blocks) {
+    writePod(out, static_cast<uint64_t>(blocks.size()));
+    for (const Block& b : blocks) writeBlock(out, b);
+}
+
+inline bool readBlocks(std::istream& in, std::vector<Block>& blocks) {
+    uint64_t count = 0;
+    if (!readPod(in, count)) return false;
+    blocks.clear();
+    blocks.reserve(count < 4096 ? count : 4096);
+    for (uint64_t i = 0; i < count; ++i) {
+        Block b;
+        if (!readBlock(in, b)) return false;
+        blocks.push_back(std::move(b));
+    }
+    return true;
+}
@@ -0,0 +1,137 @@
+#include "Snapshot.h"
+#include "Serialization.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static const char kSnapshotMagic[8] = {'C', 'O', 'R', 'A', 'M', 'S', 'N', 'P'};
+
+bool saveSnapshot(const std::string& path,
+                  const ORAMTree& tree,
+                  const PositionMap& positionMap,
+                  const Stash& stash,
+                  const StashSet& stashSet,
+                  const DRLogSet& drl,
+                  const QueryLog& qlog)
+{
+    // Serialize into memory first so that no structure is locked while we wait on the disk
+    std::ostringstream buffer(std::ios::binary);
+    buffer.write(kSnapshotMagic, sizeof(kSnapshotMagic));
+    writePod(buffer, kSnapshotVersion);
+
+    {
+        // Queries and round transitions move blocks between these structures, so they are
+        // held off while the copy is taken; the disk write below runs with queries going again
+        auto quiet = qlog.quiesce();
+        tree.serialize(buffer);
+        positionMap.serialize(buffer);
+        stash.serialize(buffer);
+        stashSet.serialize(buffer);
+        drl.serialize(buffer);
+        qlog.serialize(buffer);
+    }
+
+    // Write to a temp file and rename so a crash never leaves a half-written snapshot behind
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Error: Cannot open snapshot file " << tmpPath << " for writing.\n";
+            return false;
+        }
+        const std::string& bytes = buffer.str();
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!out) {
+            std::cerr << "Error: Failed writing snapshot to " << tmpPath << ".\n";
+            return false;
+        }
+    }
+
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: Cannot move snapshot into place at " << path << ".\n";
+        return false;
+    }
+    return true;
+}
+
+std::future<bool> saveSnapshotInBackground(const std::string& path,
+                                           std::shared_ptr<ORAMTree> tree,
+                                           std::shared_ptr<PositionMap> positionMap,
+                                           std::shared_ptr<Stash> stash,
+                                           std::shared_ptr<StashSet> stashSet,
+                                           std::shared_ptr<DRLogSet> drl,
+                                           std::shared_ptr<QueryLog> qlog)
+{
+    return std::async(std::launch::async, [=]() {
+        return saveSnapshot(path, *tree, *positionMap, *stash, *stashSet, *drl, *qlog);
+    });
+}
+
+bool restoreSnapshot(const std::string& path,
+                     ORAMTree& tree,
+                     PositionMap& positionMap,
+                     Stash& stash,
+                     StashSet& stashSet,
+                     DRLogSet& drl,
+                     QueryLog& qlog)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        std::cerr << "Error: Cannot open snapshot file " << path << ".\n";
+        return false;
+    }
+
+    std::string bytes(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(&bytes[0], static_cast<std::streamsize>(bytes.size()));
+    if (!file) {
+        std::cerr << "Error: Failed reading snapshot file " << path << ".\n";
+        return false;
+    }
+
+    std::istringstream in(std::move(bytes), std::ios::binary);
+
+    char magic[sizeof(kSnapshotMagic)];
+    uint32_t version = 0;
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0) {
+        std::cerr << "Error: " << path << " is not an ORAM snapshot.\n";
+        return false;
+    }
+    if (!readPod(in, version) || version < kOldestSnapshotVersion || version > kSnapshotVersion) {
+        std::cerr << "Error: Unsupported snapshot version " << version
+                  << " (expected " << kOldestSnapshotVersion << " to " << kSnapshotVersion << ").\n";
+        return false;
+    }
+
+    // Parse and check the whole file before touching the live state, so that a truncated or
+    // corrupt snapshot leaves it exactly as it was
+    ORAMTree parsedTree(0, 0, true);
+    PositionMap parsedPositionMap;
+    Stash parsedStash;
+    StashSet parsedStashSet(0);
+    DRLogSet parsedDrl(drl.getRoundSize());
+    QueryLog parsedQlog;
+    if (!parsedTree.deserialize(in, version) ||
+        !parsedPositionMap.deserialize(in, version) ||
+        !parsedStash.deserialize(in) ||
+        !parsedStashSet.deserialize(in) ||
+        !parsedDrl.deserialize(in) ||
+        !parsedQlog.deserialize(in) ||
+        in.peek() != std::char_traits<char>::eof())
+    {
+        std::cerr << "Error: Snapshot " << path << " is truncated or corrupt.\n";
+        return false;
+    }
+
+    auto quiet = qlog.quiesce();
+    tree.restoreFrom(parsedTree);
+    positionMap.restoreFrom(parsedPositionMap);
+    stash.restoreFrom(parsedStash);
+    stashSet.restoreFrom(parsedStashSet);
+    drl.restoreFrom(parsedDrl);
+    qlog.restoreFrom(parsedQlog);
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ORAMTree.h"
+#include "PositionMap.h"
+#include "Stash.h"
+#include "StashSet.h"
+#include "DRLogSet.h"
+#include "QueryLog.h"
+#include <future>
+#include <memory>
+#include <string>
+
+// Versioned binary snapshot of the full ORAM state.
+//
+// Layout: 8-byte magic "CORAMSNP", uint32 format version, then the
+// ORAMTree, PositionMap, Stash, StashSet, DRLogSet and QueryLog sections
+// in that order. Queries are held off (QueryLog::quiesce) only while the
+// state is copied into memory, so the copy is one consistent cut; the
+// file itself is written with queries running again.
+
+// Snapshots are written in the current version; restore also reads every older one.
+// v1: 32-bit node and leaf indices, dense trees only
+// v2: 64-bit node and leaf indices, sparse flag
+const uint32_t kSnapshotVersion = 2;
+const uint32_t kOldestSnapshotVersion = 1;
+
+bool saveSnapshot(const std::string& path,
+                  const ORAMTree& tree,
+                  const PositionMap& positionMap,
+                  const Stash& stash,
+                  const StashSet& stashSet,
+                  const DRLogSet& drl,
+                  const QueryLog& qlog);
+
+// Runs saveSnapshot on its own thread; the shared_ptrs keep the state alive until it is done
+std::future<bool> saveSnapshotInBackground(const std::string& path,
+                                           std::shared_ptr<ORAMTree> tree,
+                                           std::shared_ptr<PositionMap> positionMap,
+                                           std::shared_ptr<Stash> stash,
+                                           std::shared_ptr<StashSet> stashSet,
+                                           std::shared_ptr<DRLogSet> drl,
+                                           std::shared_ptr<QueryLog> qlog);
+
+// Bulk-reads the file in one go and rebuilds every structure from it. The whole file is parsed
+// and checked first; if any of it is bad, nothing is changed and false is returned.
+bool restoreSnapshot(const std::string& path,
+                     ORAMTree& tree,
+                     PositionMap& positionMap,
+                     Stash& stash,
+                     StashSet& stashSet,
+                     DRLogSet& drl,
+                     QueryLog& qlog);
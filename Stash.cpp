@@ -2,10 +2,23 @@
 #include <mutex>  // Required for std::unique_lock and std::shared_mutex
 #include <random>
 #include <algorithm>
+#include "Serialization.h"
+#include "Random.h"
+
+Stash::Stash(size_t capacity) : capacity(capacity) {}
 
 void Stash::addBlock(const Block& block) {
+    if (block.isDummy) return; // dummies carry nothing worth keeping
+
     std::unique_lock lock(stashMutex);
+    for (Block& b : stash) {
+        if (b.id == block.id) {
+            b = block;
+            return;
+        }
+    }
     stash.push_back(block);
+    highWaterMark = std::max(highWaterMark, stash.size());
 }
 
 Block Stash::fetchBlock(int id) {
@@ -39,9 +52,61 @@ std::vector<Block> Stash::getAllBlocks() const {
 }
 
 
+void Stash::evict(const std::function<bool(const Block&)>& tryPlace) {
+    std::unique_lock lock(stashMutex);
+    stash.erase(std::remove_if(stash.begin(), stash.end(), tryPlace), stash.end());
+}
+
+size_t Stash::size() const {
+    std::shared_lock lock(stashMutex);
+    return stash.size();
+}
+
+size_t Stash::getCapacity() const {
+    return capacity;
+}
+
+bool Stash::isOverCapacity() const {
+    std::shared_lock lock(stashMutex);
+    return capacity > 0 && stash.size() > capacity;
+}
+
+size_t Stash::getHighWaterMark() const {
+    std::shared_lock lock(stashMutex);
+    return highWaterMark;
+}
+
+void Stash::recordForcedEviction() {
+    ++forcedEvictions;
+}
+
+long long Stash::getForcedEvictions() const {
+    return forcedEvictions.load();
+}
+
 void Stash::reshuffle() {
     std::unique_lock lock(stashMutex);
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(stash.begin(), stash.end(), g);
-}
\ No newline at end of file
+    std::shuffle(stash.begin(), stash.end(), randomEngine());
+}
+
+void Stash::serialize(std::ostream& out) const {
+    std::shared_lock lock(stashMutex);
+    writeBlocks(out, stash);
+}
+
+bool Stash::deserialize(std::istream& in) {
+    std::vector<Block> restored;
+    if (!readBlocks(in, restored)) return false;
+
+    std::unique_lock lock(stashMutex);
+    stash = std::move(restored);
+    highWaterMark = std::max(highWaterMark, stash.size());
+    return true;
+}
+
+void Stash::restoreFrom(Stash& parsed) {
+    std::scoped_lock lock(stashMutex, parsed.stashMutex);
+    stash = std::move(parsed.stash);
+    parsed.stash.clear();
+    highWaterMark = std::max(highWaterMark, stash.size());
+}
@@ -3,17 +3,41 @@
 #include "Block.h"
 #include <vector>
 #include <shared_mutex>
+#include <atomic>
+#include <functional>
+#include <iosfwd>
 
 class Stash {
 private:
     std::vector<Block> stash;
     mutable std::shared_mutex stashMutex;
 
+    // Occupancy bound and pressure metrics; capacity 0 means unbounded
+    size_t capacity;
+    size_t highWaterMark = 0;
+    std::atomic<long long> forcedEvictions{0};
+
 public:
-    void addBlock(const Block& block);
+    explicit Stash(size_t capacity = 0);
+
+    void addBlock(const Block& block); // replaces any block with the same ID, ignores dummies
     Block fetchBlock(int id);
     bool contains(int id) const;
     void clear();
     std::vector<Block> getAllBlocks() const;
     void reshuffle();
+
+    // Offers every block to tryPlace and drops the ones it accepted (used for eviction)
+    void evict(const std::function<bool(const Block&)>& tryPlace);
+
+    size_t size() const;
+    size_t getCapacity() const;
+    bool isOverCapacity() const;
+    size_t getHighWaterMark() const;
+    void recordForcedEviction();
+    long long getForcedEvictions() const;
+
+    void serialize(std::ostream& out) const;
+    bool deserialize(std::istream& in);
+    void restoreFrom(Stash& parsed); // takes over the state of one just deserialized
 };
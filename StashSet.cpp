@@ -2,6 +2,8 @@
 #include <random>
 #include <algorithm>
 #include <iostream>
+#include <mutex>
+#include "Serialization.h"
 
 StashSet::StashSet(int numClients) {
 for (int i = 0; i < numClients; ++i) {
@@ -10,6 +12,7 @@ for (int i = 0; i < numClients; ++i) {
 }
 
 void StashSet::addBlockToStash(int stashIndex, const Block& block) {
+    std::shared_lock lock(setMutex);
     if (stashIndex < tempStashes.size()) {
         tempStashes[stashIndex]->addBlock(block); 
     }
@@ -17,6 +20,7 @@ void StashSet::addBlockToStash(int stashIndex, const Block& block) {
 
 
 std::vector<Block> StashSet::readStashSet(int id, int queryId) {
+    std::shared_lock lock(setMutex);
     std::vector<Block> result;
     bool found = false;
 
@@ -51,12 +55,59 @@ std::vector<Block> StashSet::readStashSet(int id, int queryId) {
 
 
 void StashSet::clear() {
+    std::shared_lock lock(setMutex);
     for (auto& stash : tempStashes) {
         stash->clear(); 
     }
 }
 
 Stash& StashSet::getStash(int index) {
+    std::shared_lock lock(setMutex);
     return *tempStashes.at(index);  // * becuase of the unique_ptr in the StashSet class
 }
 
+
+int StashSet::size() const {
+    std::shared_lock lock(setMutex);
+    return static_cast<int>(tempStashes.size());
+}
+
+void StashSet::resize(int numClients) {
+    std::unique_lock lock(setMutex);
+    while (static_cast<int>(tempStashes.size()) < numClients) {
+        tempStashes.push_back(std::make_unique<Stash>());
+    }
+    if (static_cast<int>(tempStashes.size()) > numClients) {
+        tempStashes.resize(numClients);
+    }
+}
+
+void StashSet::serialize(std::ostream& out) const {
+    std::shared_lock lock(setMutex);
+    writePod(out, static_cast<uint32_t>(tempStashes.size()));
+    for (const auto& stash : tempStashes) {
+        stash->serialize(out);
+    }
+}
+
+bool StashSet::deserialize(std::istream& in) {
+    uint32_t count = 0;
+    if (!readPod(in, count)) return false;
+
+    std::vector<std::unique_ptr<Stash>> restored;
+    for (uint32_t i = 0; i < count; ++i) {
+        auto stash = std::make_unique<Stash>();
+        if (!stash->deserialize(in)) return false;
+        restored.push_back(std::move(stash));
+    }
+
+    std::unique_lock lock(setMutex);
+    tempStashes = std::move(restored);
+    return true;
+}
+
+void StashSet::restoreFrom(StashSet& parsed) {
+    std::scoped_lock lock(setMutex, parsed.setMutex);
+    tempStashes = std::move(parsed.tempStashes);
+    parsed.tempStashes.clear();
+}
@@ -4,15 +4,24 @@
 #include "Block.h"
 #include <vector>
 #include <memory>
+#include <iosfwd>
+#include <shared_mutex>
 
 class StashSet {
 private:
     std::vector<std::unique_ptr<Stash>> tempStashes;
+    mutable std::shared_mutex setMutex; // exclusive only while the set is resized or restored
 public:
     StashSet(int numClients);  // initialize with c stashes
     std::vector<Block> readStashSet(int id, int queryId);
     void addBlockToStash(int stashIndex, const Block& block);
     void clear();
     Stash& getStash(int index);
+    int size() const;
+    void resize(int numClients); // between rounds only: references from getStash may dangle
+
+    void serialize(std::ostream& out) const;
+    bool deserialize(std::istream& in);
+    void restoreFrom(StashSet& parsed); // takes over the state of one just deserialized
 
 };
@@ -0,0 +1,164 @@
+#include "Trace.h"
+#include "Random.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+static const char* kTraceHeader = "# concuroram trace v1";
+
+bool TraceRecorder::start(const std::string& path) {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (out.is_open()) out.close();
+
+    out.open(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error: Cannot open trace file " << path << " for writing.\n";
+        return false;
+    }
+    out << kTraceHeader << "\n";
+    startTime = std::chrono::steady_clock::now();
+    recorded = 0;
+    return true;
+}
+
+void TraceRecorder::stop() {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (out.is_open()) out.close();
+}
+
+bool TraceRecorder::isRecording() const {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    return out.is_open();
+}
+
+long long TraceRecorder::getRecordedCount() const {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    return recorded;
+}
+
+void TraceRecorder::pause() {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    paused = true;
+}
+
+void TraceRecorder::resume() {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    paused = false;
+}
+
+void TraceRecorder::record(int clientId, int blockId) {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (!out.is_open() || paused) return;
+
+    auto offset = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+    out << offset.count() << " " << clientId << " " << blockId << "\n";
+    ++recorded;
+}
+
+bool loadTrace(const std::string& path, std::vector<TraceEntry>& entries) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Error: Cannot open trace file " << path << ".\n";
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(in, line) || line != kTraceHeader) {
+        std::cerr << "Error: " << path << " is not a query trace.\n";
+        return false;
+    }
+
+    entries.clear();
+    int lineNumber = 1;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream fields(line);
+        TraceEntry e;
+        if (!(fields >> e.arrivalUs >> e.clientId >> e.blockId)) {
+            std::cerr << "Error: Malformed trace line " << lineNumber << " in " << path << ".\n";
+            return false;
+        }
+        entries.push_back(e);
+    }
+    return true;
+}
+
+bool replayTrace(const std::string& path, double speed,
+                 const std::function<void(int clientId, int blockId)>& issueQuery)
+{
+    std::vector<TraceEntry> entries;
+    if (!loadTrace(path, entries)) return false;
+
+    // Random stream of each entry: its client ID and how many of that client's queries came before
+    std::vector<uint64_t> streams;
+    std::unordered_map<int, uint32_t> issuedByClient;
+    for (const TraceEntry& e : entries) {
+        streams.push_back((static_cast<uint64_t>(static_cast<uint32_t>(e.clientId)) << 32) | issuedByClient[e.clientId]++);
+    }
+    auto issue = [&](size_t i) {
+        seedRandomStream(streams[i]);
+        issueQuery(entries[i].clientId, entries[i].blockId);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    if (speed <= 0) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            issue(i);
+        }
+    } else {
+        std::mutex dueMutex;
+        std::condition_variable dueCv;
+        std::deque<size_t> due;
+        bool dispatched = false;
+
+        std::vector<std::thread> workers;
+        int numWorkers = static_cast<int>(std::min<size_t>(entries.size(), kReplayWorkers));
+        for (int w = 0; w < numWorkers; ++w) {
+            workers.emplace_back([&]() {
+                while (true) {
+                    size_t i;
+                    {
+                        std::unique_lock<std::mutex> lock(dueMutex);
+                        dueCv.wait(lock, [&] { return dispatched || !due.empty(); });
+                        if (due.empty()) return; // dispatched and drained
+                        i = due.front();
+                        due.pop_front();
+                    }
+                    issue(i);
+                }
+            });
+        }
+
+        for (size_t i = 0; i < entries.size(); ++i) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<long long>(entries[i].arrivalUs / speed)));
+            {
+                std::lock_guard<std::mutex> lock(dueMutex);
+                due.push_back(i);
+            }
+            dueCv.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lock(dueMutex);
+            dispatched = true;
+        }
+        dueCv.notify_all();
+        for (auto& t : workers) t.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double, std::milli> elapsed = end - start;
+    std::cout << "\n[Trace Replay] " << entries.size() << " queries from " << path
+              << " in " << elapsed.count() << " ms";
+    if (!entries.empty()) {
+        std::cout << " (recorded span " << entries.back().arrivalUs / 1000.0 << " ms, speed "
+                  << (speed > 0 ? std::to_string(speed) + "x" : std::string("back to back")) << ")";
+    }
+    std::cout << "\n";
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Query trace capture and replay.
+//
+// A trace is a text file with a "# concuroram trace v1" header followed by one line per
+// query: "<arrival offset in microseconds> <client ID> <block ID>". Replaying the same trace
+// against the same starting state (restore the snapshot taken when recording started) with
+// the same --seed reproduces the run.
+
+struct TraceEntry {
+    long long arrivalUs;
+    int clientId;
+    int blockId;
+};
+
+class TraceRecorder {
+private:
+    std::ofstream out;
+    std::chrono::steady_clock::time_point startTime;
+    mutable std::mutex traceMutex;
+    long long recorded = 0;
+    bool paused = false;
+
+public:
+    bool start(const std::string& path);
+    void stop();
+    bool isRecording() const;
+    long long getRecordedCount() const;
+
+    // A paused recorder drops queries, e.g. the ones a replay issues, without closing the trace
+    void pause();
+    void resume();
+
+    void record(int clientId, int blockId); // no-op while not recording or paused
+};
+
+bool loadTrace(const std::string& path, std::vector<TraceEntry>& entries);
+
+// Issues every entry through issueQuery at its recorded arrival time divided by speed (speed 2 =
+// twice as fast), on a pool of at most kReplayWorkers threads; entries that fall due while all
+// workers are busy queue up. Speed 0 replays back to back on the calling thread, which is the
+// deterministic mode for bisecting: with a global seed set, each entry's random draws come from
+// a stream of its own (see seedRandomStream), keyed by its client ID and its position among that
+// client's entries. The caller must keep anything else from sealing rounds meanwhile (pause
+// the RoundScheduler).
+const int kReplayWorkers = 64;
+
+bool replayTrace(const std::string& path, double speed,
+                 const std::function<void(int clientId, int blockId)>& issueQuery);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+// Node indices and leaf (path) IDs are 64-bit so that sparse trees can go far beyond depth 30
+using NodeIndex = std::int64_t;
+using LeafId = std::int64_t;
+
+// Compile-time index math for a complete Arity-ary tree stored in array order:
+// the root is node 0 and the children of node i are Arity*i + 1 ... Arity*i + Arity.
+// Levels and leaf IDs start from zero, like the rest of the tree code.
+
+template <int Arity>
+struct TreeGeometry {
+    static_assert(Arity >= 2, "A tree needs at least two children per node");
+
+    static constexpr NodeIndex power(int level) {
+        NodeIndex result = 1;
+        for (int i = 0; i < level; ++i) result *= Arity;
+        return result;
+    }
+
+    // Deepest tree whose node indices still fit in a NodeIndex
+    static constexpr int maxDepth() {
+        int depth = 0;
+        NodeIndex widest = Arity; // Arity^(depth + 1)
+        while (widest <= std::numeric_limits<NodeIndex>::max() / Arity) {
+            widest *= Arity;
+            ++depth;
+        }
+        return depth;
+    }
+
+    // Index of the first node on the given level (== number of nodes above it)
+    static constexpr NodeIndex levelStart(int level) {
+        return (power(level) - 1) / (Arity - 1);
+    }
+
+    static constexpr NodeIndex nodeCount(int depth) {
+        return levelStart(depth + 1);
+    }
+
+    static constexpr LeafId leafCount(int depth) {
+        return power(depth);
+    }
+
+    static constexpr NodeIndex leafIndex(LeafId leafId, int depth) {
+        return levelStart(depth) + leafId;
+    }
+
+    static constexpr NodeIndex parent(NodeIndex index) {
+        return (index - 1) / Arity;
+    }
+
+    // Leaf ID of a leaf node index, or -1 if the node is not a leaf
+    static constexpr LeafId pathId(NodeIndex nodeIndex, int depth) {
+        return (nodeIndex >= levelStart(depth) && nodeIndex < nodeCount(depth))
+            ? nodeIndex - levelStart(depth) : -1;
+    }
+
+    // Smallest depth whose leaf level has at least `leaves` leaves
+    static constexpr int depthForLeaves(LeafId leaves) {
+        int depth = 0;
+        while (leafCount(depth) < leaves) ++depth;
+        return depth;
+    }
+};
+
+static_assert(TreeGeometry<2>::nodeCount(2) == 7, "binary tree of depth 2 has 7 nodes");
+static_assert(TreeGeometry<2>::leafIndex(0, 2) == 3, "leftmost binary leaf at depth 2 is node 3");
+static_assert(TreeGeometry<4>::nodeCount(2) == 21, "4-ary tree of depth 2 has 21 nodes");
+static_assert(TreeGeometry<8>::parent(TreeGeometry<8>::leafIndex(63, 2)) == 8, "last 8-ary leaf hangs off node 8");
+static_assert(TreeGeometry<4>::parent(4 * 5 + 1) == 5 && TreeGeometry<4>::parent(4 * 5 + 4) == 5,
+              "4-ary children of node i are 4i + 1 to 4i + 4");
+static_assert(TreeGeometry<4>::leafIndex(15, 2) == 20 && TreeGeometry<4>::pathId(20, 2) == 15,
+              "last 4-ary leaf at depth 2 is node 20");
+static_assert(TreeGeometry<4>::pathId(4, 2) == -1, "inner 4-ary nodes are not leaves");
+static_assert(TreeGeometry<8>::levelStart(3) == 73 && TreeGeometry<8>::leafCount(3) == 512,
+              "8-ary depth-3 leaves start at node 73");
+static_assert(TreeGeometry<2>::maxDepth() == 61, "binary node indices fit in 64 bits up to depth 61");
@@ -1,7 +1,9 @@
 #pragma once
 #include "Block.h"
+#include "BucketCipher.h"
 #include <vector>
 
 struct TreeNode {
     std::vector<Block> bucket;
+    SealedBucket sealed; // server-side ciphertext when the tree is encrypted; bucket is then empty
 };
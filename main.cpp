@@ -14,6 +14,15 @@
 #include "DRLogSet.h" // class DRLogSet defined in this file
 #include "QueryLog.h"
 #include "StashSet.h" // class StashSet defined in this file
+#include "ORAMQuery.h" // class ORAMQuery defined in this file
+#include "Snapshot.h" // binary snapshot / restore of all of the above
+#include "Benchmark.h" // tree geometry benchmark driver
+#include "PartitionedORAM.h" // class PartitionedORAM defined in this file
+#include "RoundScheduler.h" // class RoundScheduler defined in this file
+#include "Trace.h" // query trace capture and replay
+#include "Random.h" // shared, optionally seeded random engine
+#include "ConstantRateScheduler.h" // class ConstantRateScheduler defined in this file
+#include "RingORAM.h" // class RingORAM defined in this file
 
 
 // parallel header files
@@ -24,6 +33,9 @@
 #include <random>
 #include <cmath>
 #include <iomanip>
+#include <future>
+#include <stdexcept>
+#include <atomic>
 
 
 using namespace std;
@@ -31,94 +43,25 @@ using namespace std;
 
 
 
-// ORAM Query
-class ORAMQuery {
-private:
-    ORAMTree& tree;
-    PositionMap& positionMap;
-    Stash& stash;
-    DRLogSet& drLogSet;
-    QueryLog& queryLog;  
-
-public:
-     ORAMQuery(ORAMTree& tree, PositionMap& positionMap, Stash& stash, DRLogSet& drLogSet, QueryLog& queryLog)
-        : tree(tree), positionMap(positionMap), stash(stash), drLogSet(drLogSet), queryLog(queryLog) {}
-
-    // Main PathORAM-style Read Operation
-     Block read(int blockId)
-     {
-         auto [queryId, isOverlap] = queryLog.registerQuery(blockId);
-
-         if (isOverlap)
-         {
-            cout << "Overlapped Block:" << " " << blockId << endl;
-             // Dummy read (simulate a random path fetch but ignore result)
-             int dummyPath = rand() % (1 << tree.getDepth());
-             std::vector<int> pathIndices = tree.getPathIndices(dummyPath);
-             for (int idx : pathIndices)
-             {
-                TreeNode node = tree.getNode(idx);
-                for (const Block &b : node.bucket){
-                   stash.addBlock(b);
-                }
-             }
-
-             // Wait until previous queries are done (in real system, check DRL count)
-             std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-             // Try to get it from the DRLogSet
-             auto results = drLogSet.readLogSet(blockId);
-             for (const auto &b : results){
-                if (b.id == blockId)
-                return b;
-             }
-
-             return Block(-1, "", true); // If still not found
-        } else {
-            int leafId = positionMap.getPosition(blockId);
-            if (leafId == -1)
-            {
-                Block dummy(-1, "", true);
-                drLogSet.writeLogSet(dummy, queryId);
-                return dummy;
-            }
-    
-            std::vector<int> pathIndices = tree.getPathIndices(leafId);
-            for (int idx : pathIndices)
-            {
-                TreeNode node = tree.getNode(idx);
-                for (const Block &b : node.bucket)
-                {
-                    stash.addBlock(b);
-                }
-            }
-    
-            Block result = stash.fetchBlock(blockId);
-            if (result.id == -1)
-                result = Block(-1, "", true);
-    
-            drLogSet.writeLogSet(result, queryId);
-
-            return result;
-        }
-
-         
-    }
-};
-
 void clientQuery(int clientId, int blockId,
             std::shared_ptr<ORAMTree> tree,
             std::shared_ptr<PositionMap> positionMap,
             std::shared_ptr<Stash> stash,
             std::shared_ptr<DRLogSet> drl,
-            std::shared_ptr<QueryLog> qlog)
+            std::shared_ptr<QueryLog> qlog,
+            std::shared_ptr<RoundScheduler> scheduler,
+            std::shared_ptr<TraceRecorder> recorder,
+            std::shared_ptr<RingORAM> ring)
 {
-    ORAMQuery query(*tree, *positionMap, *stash, *drl, *qlog);
+    ORAMQuery query(*tree, *positionMap, *stash, *drl, *qlog, ring.get());
+    recorder->record(clientId, blockId);
+    scheduler->recordArrival();
     auto start = std::chrono::high_resolution_clock::now();
     Block result = query.read(blockId);
     auto end = std::chrono::high_resolution_clock::now();
 
     std::chrono::duration<double, std::milli> latency = end - start;
+    scheduler->recordCompletion(latency.count());
 
     std::cout << "Read Result: [ID: " << result.id
     << ", Data: " << result.data
@@ -131,9 +74,15 @@ void clientQuery(int clientId, int blockId,
 
 // utility function to print the ORAM tree in ASCII format
 void displayORAMtree(const ORAMTree& tree, int depth) {
-    int totalNodes = (1 << (depth + 1)) - 1;
+    if (depth > 6) {
+        std::cout << "\n[ORAMTree] Too deep to draw (depth " << depth << ", "
+                  << tree.getAllocatedBucketCount() << " allocated buckets)\n";
+        return;
+    }
+
+    NodeIndex totalNodes = ORAMTree::Geometry::nodeCount(depth);
     int level = 0;
-    int nodesPrinted = 0;
+    NodeIndex nodesPrinted = 0;
 
     std::cout << "\n[ORAMTree ASCII Representation]\n";
 
@@ -195,13 +144,13 @@ void defaultPositionMapPopulate(std::shared_ptr<PositionMap> positionMap) {
     positionMap->updatePosition(6, 3);
 }
 
-int computePathID(int nodeIndex, int depth) {
-    int leafStartIndex = (1 << depth) - 1;
-    if (nodeIndex < leafStartIndex) {
+LeafId computePathID(NodeIndex nodeIndex, int depth) {
+    LeafId pathId = ORAMTree::Geometry::pathId(nodeIndex, depth);
+    if (pathId < 0) {
         std::cerr << "Error: Node index " << nodeIndex << " is not a leaf.\n";
         return -1; // invalid
     }
-    return nodeIndex - leafStartIndex;
+    return pathId;
 }
 
 void interactiveMenu(std::shared_ptr<ORAMTree> tree,
@@ -209,8 +158,14 @@ void interactiveMenu(std::shared_ptr<ORAMTree> tree,
                      std::shared_ptr<Stash> stash,
                      std::shared_ptr<DRLogSet> drl,
                      std::shared_ptr<QueryLog> qlog,
+                     std::shared_ptr<StashSet> stashSet,
+                     std::shared_ptr<RoundScheduler> scheduler,
+                     std::shared_ptr<TraceRecorder> recorder,
+                     std::shared_ptr<RingORAM> ring,
                      int depth)
 {
+    std::future<bool> pendingSnapshot; // background snapshot still being written, if any
+
     while (true)
     {
         std::cout << "\n==== Interactive Menu ====\n";
@@ -223,6 +178,20 @@ void interactiveMenu(std::shared_ptr<ORAMTree> tree,
         std::cout << "7. Display contents of DRLogSet (Current Round)\n";
         std::cout << "8. Simulate parallel block reads\n";
         std::cout << "9. Exit the program\n";
+        std::cout << "10. Save snapshot of the ORAM state (background)\n";
+        std::cout << "11. Restore ORAM state from a snapshot\n";
+        std::cout << "12. Display treetop cache statistics\n";
+        std::cout << "13. Benchmark tree geometries (bucket size / arity)\n";
+        std::cout << "14. Benchmark partitioned multi-tree ORAM\n";
+        std::cout << "15. Display stash occupancy metrics\n";
+        std::cout << "16. Display adaptive round scheduler state\n";
+        std::cout << "17. Start / stop recording a query trace\n";
+        std::cout << "18. Replay a query trace\n";
+        std::cout << "19. Run clients through the constant-rate scheduler\n";
+        std::cout << "20. Display Ring ORAM bandwidth statistics\n";
+        std::cout << "21. Benchmark Path ORAM vs Ring ORAM bandwidth\n";
+        std::cout << "22. Display per-phase query timings (incl. bucket encryption)\n";
+        std::cout << "23. Benchmark bucket encryption throughput\n";
         std::cout << "Select an option: ";
 
         int choice;
@@ -234,23 +203,26 @@ void interactiveMenu(std::shared_ptr<ORAMTree> tree,
             std::cout << "Enter Block ID to read: ";
             std::cin >> blockId;
 
+            // Looked up before the read, which remaps the block to a fresh path
+            LeafId leafId = positionMap->getPosition(blockId);
+
             auto start = std::chrono::high_resolution_clock::now();
-            clientQuery(1, blockId, tree, positionMap, stash, drl, qlog);
+            clientQuery(1, blockId, tree, positionMap, stash, drl, qlog, scheduler, recorder, ring);
             auto end = std::chrono::high_resolution_clock::now();
 
             std::chrono::duration<double, std::milli> latency = end - start;
             std::cout << "Fetch Latency: " << latency.count() << " ms\n";
 
-            int leafId = positionMap->getPosition(blockId);
-            std::vector<int> path = tree->getPathIndices(leafId);
+            std::vector<NodeIndex> path = tree->getPathIndices(leafId);
             std::cout << "Queried Path (Root to Leaf): ";
-            for (int idx : path)
+            for (NodeIndex idx : path)
                 std::cout << idx << " ";
             std::cout << "\n";
         }
         else if (choice == 2)
         {
-            int blockId, nodeIndex;
+            int blockId;
+            NodeIndex nodeIndex;
             std::string data;
 
             std::cout << "Enter Block ID: ";
@@ -260,17 +232,28 @@ void interactiveMenu(std::shared_ptr<ORAMTree> tree,
             std::cout << "Enter Block Data: ";
             std::getline(std::cin, data);
 
-            std::cout << "Enter Tree Node Index (0 to " << ((1 << (depth + 1)) - 2) << "): ";
+            std::cout << "Enter Tree Node Index (0 to " << (tree->getNodeCount() - 1) << "): ";
             std::cin >> nodeIndex;
 
-            int pathId = (nodeIndex >= (1 << depth) - 1) ? (nodeIndex - ((1 << depth) - 1)) : -1;
-            if (pathId < 0 || pathId >= (1 << depth))
+            LeafId pathId = ORAMTree::Geometry::pathId(nodeIndex, depth);
+            if (pathId < 0)
             {
                 std::cerr << "Error: Invalid leaf node index.\n";
                 continue;
             }
 
-            tree->addBlock(nodeIndex, Block(blockId, data, false));
+            if (ring)
+            {
+                ring->writeBlock(blockId, data, pathId);
+                std::cout << "Block inserted into Ring ORAM and mapped to path ID " << pathId << ".\n";
+                continue;
+            }
+
+            if (!tree->addBlock(nodeIndex, Block(blockId, data, false)))
+            {
+                std::cerr << "Error: Bucket " << nodeIndex << " is full.\n";
+                continue;
+            }
             positionMap->updatePosition(blockId, pathId);
             std::cout << "Block inserted and mapped to path ID " << pathId << ".\n";
         }
@@ -311,7 +294,7 @@ void interactiveMenu(std::shared_ptr<ORAMTree> tree,
 
             for (int i = 0; i < numThreads; ++i)
             {
-                threads.emplace_back(clientQuery, i + 1, blockIds[i], tree, positionMap, stash, drl, qlog);
+                threads.emplace_back(clientQuery, i + 1, blockIds[i], tree, positionMap, stash, drl, qlog, scheduler, recorder, ring);
             }
 
             for (auto &t : threads)
@@ -321,10 +304,277 @@ void interactiveMenu(std::shared_ptr<ORAMTree> tree,
         }
         else if (choice == 9)
         {
-            
+            if (pendingSnapshot.valid() && !pendingSnapshot.get())
+                std::cerr << "Previous snapshot failed.\n";
+
             std::cout << "Exiting the program...\n";
             break;
         }
+        else if (choice == 10)
+        {
+            if (ring)
+            {
+                // The Ring buckets and their slot metadata would be missing from the snapshot
+                std::cerr << "Error: Snapshots are not supported in Ring ORAM mode.\n";
+                continue;
+            }
+
+            std::string path;
+            std::cout << "Enter snapshot file path: ";
+            std::cin >> path;
+
+            if (pendingSnapshot.valid() && !pendingSnapshot.get())
+                std::cerr << "Previous snapshot failed.\n";
+
+            pendingSnapshot = saveSnapshotInBackground(path, tree, positionMap, stash, stashSet, drl, qlog);
+            std::cout << "Snapshot to " << path << " started in the background.\n";
+        }
+        else if (choice == 11)
+        {
+            if (ring)
+            {
+                std::cerr << "Error: Snapshots are not supported in Ring ORAM mode.\n";
+                continue;
+            }
+
+            std::string path;
+            std::cout << "Enter snapshot file path: ";
+            std::cin >> path;
+
+            if (pendingSnapshot.valid() && !pendingSnapshot.get())
+                std::cerr << "Previous snapshot failed.\n";
+
+            auto start = std::chrono::high_resolution_clock::now();
+            bool ok = restoreSnapshot(path, *tree, *positionMap, *stash, *stashSet, *drl, *qlog);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            if (ok)
+            {
+                depth = tree->getDepth();
+                std::chrono::duration<double, std::milli> elapsed = end - start;
+                std::cout << "Restored ORAM state (depth " << depth << ") in " << elapsed.count() << " ms\n";
+            }
+        }
+        else if (choice == 12)
+        {
+            long long serverReads = tree->getServerBucketReads();
+            long long cachedReads = tree->getTreetopBucketReads();
+            long long totalReads = serverReads + cachedReads;
+
+            std::cout << "\n[Treetop Cache]\n";
+            std::cout << "  Cached levels: " << tree->getTreetopLevels() << " of " << (depth + 1) << "\n";
+            std::cout << "  Bucket reads served by the treetop: " << cachedReads << "\n";
+            std::cout << "  Bucket reads fetched from the server: " << serverReads << "\n";
+            if (totalReads > 0)
+                std::cout << "  Server traffic saved: " << (100.0 * cachedReads / totalReads) << "%\n";
+        }
+        else if (choice == 13)
+        {
+            int numBlocks, numQueries;
+            std::cout << "Enter number of blocks to store: ";
+            std::cin >> numBlocks;
+            std::cout << "Enter number of path reads to run: ";
+            std::cin >> numQueries;
+
+            benchmarkGeometries(numBlocks, numQueries);
+        }
+        else if (choice == 14)
+        {
+            int numPartitions, numBlocks, numQueries, numClients, reshuffleInterval;
+            std::cout << "Enter number of partitions (P): ";
+            std::cin >> numPartitions;
+            std::cout << "Enter number of blocks to store: ";
+            std::cin >> numBlocks;
+            std::cout << "Enter number of reads to run: ";
+            std::cin >> numQueries;
+            std::cout << "Enter number of client threads: ";
+            std::cin >> numClients;
+            std::cout << "Reshuffle blocks between partitions every how many reads? (1 = after every read): ";
+            std::cin >> reshuffleInterval;
+
+            if (numPartitions < 1 || numBlocks < 1 || numQueries < 1 || numClients < 1 || reshuffleInterval < 1)
+            {
+                std::cerr << "Error: Invalid partitioned benchmark parameters.\n";
+                continue;
+            }
+
+            PartitionedORAM oram(numPartitions, depth, drl->getRoundSize(), reshuffleInterval, tree->isSparse());
+            for (int id = 0; id < numBlocks; ++id)
+                oram.write(id, "Block " + std::to_string(id));
+
+            std::atomic<int> misses{0};
+            std::vector<std::thread> clients;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int t = 0; t < numClients; ++t)
+            {
+                int share = numQueries / numClients + (t < numQueries % numClients ? 1 : 0);
+                clients.emplace_back([&oram, &misses, share, numBlocks]() {
+                    std::uniform_int_distribution<int> blockDist(0, numBlocks - 1);
+                    for (int q = 0; q < share; ++q)
+                    {
+                        if (oram.read(blockDist(randomEngine())).isDummy)
+                            ++misses;
+                    }
+                });
+            }
+            for (auto &t : clients)
+                t.join();
+            auto end = std::chrono::high_resolution_clock::now();
+
+            std::chrono::duration<double> elapsed = end - start;
+            oram.printStats();
+            std::cout << "  Throughput: " << numQueries / elapsed.count() << " queries/s over "
+                      << elapsed.count() << " s (" << misses.load() << " dummy results)\n";
+        }
+        else if (choice == 15)
+        {
+            std::cout << "\n[Stash Occupancy]\n";
+            std::cout << "  Current: " << stash->size() << " blocks\n";
+            std::cout << "  High-water mark: " << stash->getHighWaterMark() << " blocks\n";
+            if (stash->getCapacity() > 0)
+                std::cout << "  Capacity: " << stash->getCapacity() << " blocks\n";
+            else
+                std::cout << "  Capacity: unbounded\n";
+            std::cout << "  Forced evictions (backpressure): " << stash->getForcedEvictions() << "\n";
+        }
+        else if (choice == 16)
+        {
+            scheduler->printStats();
+        }
+        else if (choice == 17)
+        {
+            if (recorder->isRecording())
+            {
+                recorder->stop();
+                std::cout << "Stopped recording after " << recorder->getRecordedCount() << " queries.\n";
+                continue;
+            }
+
+            std::string path;
+            std::cout << "Enter trace file path: ";
+            std::cin >> path;
+            if (recorder->start(path))
+                std::cout << "Recording queries to " << path
+                          << " (snapshot now with option 10 to replay from the same state).\n";
+        }
+        else if (choice == 18)
+        {
+            std::string path;
+            double speed;
+            std::cout << "Enter trace file path: ";
+            std::cin >> path;
+            std::cout << "Enter replay speed (1 = recorded timing, 10 = ten times faster, 0 = back to back): ";
+            std::cin >> speed;
+
+            if (hasGlobalSeed())
+                setGlobalSeed(getGlobalSeed()); // restart every random stream for a reproducible replay
+
+            // Rounds seal at c arrivals only, as when recording, and the replay is not re-recorded
+            scheduler->pause();
+            recorder->pause();
+            replayTrace(path, speed, [&](int clientId, int blockId) {
+                clientQuery(clientId, blockId, tree, positionMap, stash, drl, qlog, scheduler, recorder, ring);
+            });
+            recorder->resume();
+            scheduler->resume();
+        }
+        else if (choice == 19)
+        {
+            double roundsPerSecond, thinkTimeMs;
+            int roundWidth, numClients, queriesPerClient, maxBlockId;
+            std::cout << "Enter dispatch rate (rounds per second): ";
+            std::cin >> roundsPerSecond;
+            std::cout << "Enter round width (queries per round): ";
+            std::cin >> roundWidth;
+            std::cout << "Enter number of client threads: ";
+            std::cin >> numClients;
+            std::cout << "Enter queries per client: ";
+            std::cin >> queriesPerClient;
+            std::cout << "Enter mean client think time between queries (ms): ";
+            std::cin >> thinkTimeMs;
+            std::cout << "Enter highest block ID to request (IDs 0 to N are drawn uniformly): ";
+            std::cin >> maxBlockId;
+
+            if (roundsPerSecond <= 0 || roundWidth < 1 || numClients < 1 || queriesPerClient < 1 ||
+                thinkTimeMs < 0 || maxBlockId < 0)
+            {
+                std::cerr << "Error: Invalid constant-rate scheduler parameters.\n";
+                continue;
+            }
+
+            std::mutex latencyMutex;
+            double totalLatencyMs = 0;
+            scheduler->pause(); // the constant-rate scheduler owns the round boundaries meanwhile
+            {
+                ConstantRateScheduler crs(*tree, *positionMap, *stash, *drl, *qlog,
+                                          ConstantRatePolicy{roundsPerSecond, roundWidth}, ring.get());
+                std::vector<std::thread> clients;
+                for (int t = 0; t < numClients; ++t)
+                {
+                    clients.emplace_back([&]() {
+                        std::exponential_distribution<double> think(thinkTimeMs > 0 ? 1.0 / thinkTimeMs : 1.0);
+                        std::uniform_int_distribution<int> blockDist(0, maxBlockId);
+                        for (int q = 0; q < queriesPerClient; ++q)
+                        {
+                            if (thinkTimeMs > 0)
+                                std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(think(randomEngine())));
+
+                            auto start = std::chrono::high_resolution_clock::now();
+                            crs.submit(blockDist(randomEngine())).get();
+                            auto end = std::chrono::high_resolution_clock::now();
+
+                            std::lock_guard<std::mutex> lock(latencyMutex);
+                            totalLatencyMs += std::chrono::duration<double, std::milli>(end - start).count();
+                        }
+                    });
+                }
+                for (auto &t : clients)
+                    t.join();
+
+                crs.printStats();
+            }
+            scheduler->resume();
+            std::cout << "  End-to-end latency: avg " << totalLatencyMs / (numClients * queriesPerClient) << " ms\n";
+        }
+        else if (choice == 20)
+        {
+            if (!ring)
+            {
+                std::cout << "Ring ORAM is not enabled (select it at startup).\n";
+                continue;
+            }
+            ring->printStats();
+        }
+        else if (choice == 21)
+        {
+            int numBlocks, numQueries, Z, S, A;
+            std::cout << "Enter number of blocks to store: ";
+            std::cin >> numBlocks;
+            std::cout << "Enter number of reads to run: ";
+            std::cin >> numQueries;
+            std::cout << "Enter Ring ORAM parameters Z S A (e.g., 4 6 3): ";
+            std::cin >> Z >> S >> A;
+
+            benchmarkAccessEngines(numBlocks, numQueries, Z, S, A);
+        }
+        else if (choice == 22)
+        {
+            printQueryPhaseTimings(*tree);
+        }
+        else if (choice == 23)
+        {
+            int pathLength, blocksPerBucket, blockBytes, numPaths;
+            std::cout << "Enter buckets per path: ";
+            std::cin >> pathLength;
+            std::cout << "Enter blocks per bucket: ";
+            std::cin >> blocksPerBucket;
+            std::cout << "Enter block payload size in bytes: ";
+            std::cin >> blockBytes;
+            std::cout << "Enter number of paths to seal and open: ";
+            std::cin >> numPaths;
+
+            benchmarkBucketCrypto(pathLength, blocksPerBucket, blockBytes, numPaths);
+        }
 
         else
         {
@@ -333,12 +583,45 @@ void interactiveMenu(std::shared_ptr<ORAMTree> tree,
     }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    // --seed <n> makes every random choice reproducible (see Random.h)
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            std::string value = argv[++i];
+            uint64_t seed = 0;
+            size_t parsed = 0;
+            try {
+                seed = std::stoull(value, &parsed);
+            } catch (const std::exception&) {
+                parsed = 0; // not a number, or out of range
+            }
+            if (parsed == 0 || parsed != value.size() || value[0] == '-') {
+                std::cerr << "Error: Invalid seed " << value << ".\n";
+                std::cerr << "Usage: " << argv[0] << " [--seed <n>]\n";
+                return 1;
+            }
+            setGlobalSeed(seed);
+            std::cout << "Using fixed random seed " << getGlobalSeed() << "\n";
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--seed <n>]\n";
+            return 1;
+        }
+    }
+
     // === Tree Initialization ===
     int depth;
     int maxConcurrentQueries;
+    int treetopLevels;
+    int sparse;
+    int stashCapacity;
+    int minRoundSize, maxRoundSize;
+    double latencyTargetMs, sealDeadlineMs;
     int numBlocks;
+    int ringMode;
+    int encrypted;
+    RingPolicy ringPolicy;
 
     std::cout << "Enter the depth of the ORAM tree (e.g., 2): ";
     std::cin >> depth;
@@ -346,25 +629,105 @@ int main()
     std::cout << "Enter the max number of concurrent queries per round (c): ";
     std::cin >> maxConcurrentQueries;
 
+    std::cout << "Enter the min and max round size c for adaptive rounds (e.g., 1 8; enter c c to keep it fixed): ";
+    std::cin >> minRoundSize >> maxRoundSize;
+
+    std::cout << "Enter the query latency target and the round seal deadline in ms (e.g., 50 200): ";
+    std::cin >> latencyTargetMs >> sealDeadlineMs;
+
+    std::cout << "Enter the number of top tree levels to cache on the client (0 for none): ";
+    std::cin >> treetopLevels;
+
+    std::cout << "Allocate tree buckets lazily on first write (sparse tree)? (1 = yes, 0 = no): ";
+    std::cin >> sparse;
+
+    std::cout << "Enter the stash capacity in blocks (0 for unbounded): ";
+    std::cin >> stashCapacity;
+
+    std::cout << "Encrypt server-side buckets with ChaCha20-Poly1305? (1 = yes, 0 = no): ";
+    std::cin >> encrypted;
+
+    std::cout << "Select the access engine (0 = Path ORAM, 1 = Ring ORAM): ";
+    std::cin >> ringMode;
+    if (ringMode == 1) {
+        std::cout << "Enter Ring ORAM parameters Z S A (real slots, dummy slots, accesses per eviction; e.g., 4 6 3): ";
+        std::cin >> ringPolicy.Z >> ringPolicy.S >> ringPolicy.A;
+    }
+
     // Basic input validation
     if (depth < 1 || maxConcurrentQueries < 1) {
         std::cerr << "Error: Depth and c must both be >= 1.\n";
         return 1;
     }
+    if (minRoundSize < 1 || minRoundSize > maxConcurrentQueries || maxRoundSize < maxConcurrentQueries) {
+        std::cerr << "Error: Round size bounds must satisfy 1 <= min <= c <= max.\n";
+        return 1;
+    }
+    if (!(latencyTargetMs > 0) || !(sealDeadlineMs > 0)) {
+        std::cerr << "Error: The latency target and seal deadline must both be > 0 ms.\n";
+        return 1;
+    }
+    if (depth > ORAMTree::Geometry::maxDepth()) {
+        std::cerr << "Error: Depth must be <= " << ORAMTree::Geometry::maxDepth() << " for 64-bit node indices.\n";
+        return 1;
+    }
+    if (sparse != 1 && depth > kMaxDenseDepth) {
+        std::cerr << "Error: Dense trees are limited to depth " << kMaxDenseDepth << "; use a sparse tree.\n";
+        return 1;
+    }
+    if (stashCapacity < 0) {
+        std::cerr << "Error: Stash capacity must be >= 0.\n";
+        return 1;
+    }
+    if (ringMode == 1 && (ringPolicy.Z < 1 || ringPolicy.S < 1 || ringPolicy.A < 1)) {
+        std::cerr << "Error: Ring ORAM parameters Z, S and A must all be >= 1.\n";
+        return 1;
+    }
+    if (ringMode == 1 && sparse == 1) {
+        std::cerr << "Error: Ring ORAM allocates its buckets densely and cannot run on a sparse tree.\n";
+        return 1;
+    }
+    if (ringMode == 1 && encrypted == 1) {
+        std::cerr << "Error: Ring ORAM keeps its buckets in plaintext; bucket encryption needs Path ORAM.\n";
+        return 1;
+    }
+    if (ringMode == 1 && depth > RingORAM::kMaxDepth) {
+        std::cerr << "Error: Ring ORAM is limited to depth " << RingORAM::kMaxDepth << ".\n";
+        return 1;
+    }
+    if (treetopLevels < 0 || treetopLevels > depth + 1) {
+        std::cerr << "Error: Treetop levels must be between 0 and depth + 1.\n";
+        return 1;
+    }
+    if (sparse == 1 && treetopLevels > kMaxSparseTreetopLevels) {
+        std::cerr << "Error: A sparse tree caches at most " << kMaxSparseTreetopLevels << " treetop levels.\n";
+        return 1;
+    }
 
     std::cout << "\nInitialized ORAM tree with depth " << depth
-    << " (total nodes: " << ((1 << (depth + 1)) - 1)
+    << " (total nodes: " << ORAMTree::Geometry::nodeCount(depth)
     << "), and max " << maxConcurrentQueries << " concurrent queries.\n";
 
     
 
     // === ORAM system setup ===
-    auto tree = std::make_shared<ORAMTree>(depth);
+    auto tree = std::make_shared<ORAMTree>(depth, treetopLevels, sparse == 1);
+    if (encrypted == 1) {
+        // Fresh from the OS on every run, even with --seed: nonces restart at 1 under each key
+        tree->enableEncryption(BucketCipher::generateKey());
+    }
     auto positionMap = std::make_shared<PositionMap>();
-    auto stash = std::make_shared<Stash>();
+    auto stash = std::make_shared<Stash>(static_cast<size_t>(stashCapacity));
     auto drl = std::make_shared<DRLogSet>(maxConcurrentQueries);
-    auto qlog = std::make_shared<QueryLog>();
+    auto qlog = std::make_shared<QueryLog>(maxConcurrentQueries);
     auto stashSet = std::make_shared<StashSet>(maxConcurrentQueries);
+    auto scheduler = std::make_shared<RoundScheduler>(*drl, *stashSet, *qlog,
+                                                      RoundPolicy{minRoundSize, maxRoundSize,
+                                                                  latencyTargetMs, sealDeadlineMs});
+    auto recorder = std::make_shared<TraceRecorder>();
+    std::shared_ptr<RingORAM> ring; // Path ORAM mode leaves this empty
+    if (ringMode == 1)
+        ring = std::make_shared<RingORAM>(depth, *positionMap, *stash, ringPolicy);
 
 
     // displayORAMtree(*tree, depth);
@@ -373,11 +736,11 @@ int main()
     // defaultPopulate(tree);
     // defaultPositionMapPopulate(positionMap);
 
-    interactiveMenu(tree, positionMap, stash, drl, qlog, depth);
+    interactiveMenu(tree, positionMap, stash, drl, qlog, stashSet, scheduler, recorder, ring, depth);
 
-    // std::thread t1(clientQuery, 1, 6, tree, positionMap, stash, drl, qlog);
+    // std::thread t1(clientQuery, 1, 6, tree, positionMap, stash, drl, qlog, scheduler, recorder, ring);
     // std::this_thread::sleep_for(std::chrono::milliseconds(10)); // slight delay
-    // std::thread t2(clientQuery, 2, 3, tree, positionMap, stash, drl, qlog);
+    // std::thread t2(clientQuery, 2, 3, tree, positionMap, stash, drl, qlog, scheduler, recorder, ring);
 
     // t1.join();
     // t2.join();
@@ -0,0 +1,98 @@
+#include "TestHarness.h"
+#include "BucketCipher.h"
+#include "Random.h"
+#include <string>
+
+namespace {
+
+std::vector<std::uint8_t> fromHex(const std::string& hex) {
+    std::vector<std::uint8_t> bytes;
+    for (std::size_t i = 0; i + 1 < hex.size(); i += 2)
+        bytes.push_back(static_cast<std::uint8_t>(std::stoul(hex.substr(i, 2), nullptr, 16)));
+    return bytes;
+}
+
+// RFC 8439 section 2.8.2
+struct Rfc8439Vector {
+    BucketKey key;
+    std::uint8_t nonce[12] = {0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47};
+    std::vector<std::uint8_t> aad = fromHex("50515253c0c1c2c3c4c5c6c7");
+    std::string plaintext = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for "
+                            "the future, sunscreen would be it.";
+    std::vector<std::uint8_t> ciphertext = fromHex(
+        "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d6"
+        "3dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b36"
+        "92ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+        "3ff4def08e4b7a9de576d26586cec64b6116");
+    std::vector<std::uint8_t> tag = fromHex("1ae10b594f09e26a7e902ecbd0600691");
+
+    Rfc8439Vector() {
+        for (std::size_t i = 0; i < key.size(); ++i) key[i] = static_cast<std::uint8_t>(0x80 + i);
+    }
+};
+
+} // namespace
+
+TEST(BucketCipherMatchesRfc8439Vector)
+{
+    Rfc8439Vector v;
+    std::vector<std::uint8_t> data(v.plaintext.begin(), v.plaintext.end());
+    std::array<std::uint8_t, 16> tag{};
+    BucketCipher::sealBytes(v.key, v.nonce, v.aad, data, tag);
+    CHECK(data == v.ciphertext);
+    CHECK(std::vector<std::uint8_t>(tag.begin(), tag.end()) == v.tag);
+
+    CHECK(BucketCipher::openBytes(v.key, v.nonce, v.aad, data, tag));
+    CHECK(std::string(data.begin(), data.end()) == v.plaintext);
+}
+
+TEST(BucketCipherRejectsTampering)
+{
+    Rfc8439Vector v;
+    std::array<std::uint8_t, 16> tag{};
+    std::copy(v.tag.begin(), v.tag.end(), tag.begin());
+
+    std::vector<std::uint8_t> flipped = v.ciphertext;
+    flipped[17] ^= 0x01;
+    CHECK(!BucketCipher::openBytes(v.key, v.nonce, v.aad, flipped, tag));
+    flipped[17] ^= 0x01;
+    CHECK(flipped == v.ciphertext); // a rejected open leaves the data as it was
+
+    std::array<std::uint8_t, 16> badTag = tag;
+    badTag[15] ^= 0x80;
+    CHECK(!BucketCipher::openBytes(v.key, v.nonce, v.aad, flipped, badTag));
+
+    std::vector<std::uint8_t> badAad = v.aad;
+    badAad[0] ^= 0x01;
+    CHECK(!BucketCipher::openBytes(v.key, v.nonce, badAad, flipped, tag));
+
+    // Buckets are bound to their node index and their own nonce
+    BucketCipher cipher(BucketCipher::generateKey());
+    std::vector<Block> blocks{Block(1, "one", false), Block(2, "two", false)};
+    SealedBucket sealed = cipher.seal(5, blocks);
+    std::vector<Block> opened;
+    CHECK(cipher.open(5, sealed, opened) && opened.size() == 2 && opened[1].data == "two");
+    CHECK(!cipher.open(6, sealed, opened) && opened.empty());
+
+    SealedBucket replayed = sealed;
+    replayed.nonce = cipher.seal(5, blocks).nonce;
+    CHECK(replayed.nonce != sealed.nonce);
+    CHECK(!cipher.open(5, replayed, opened));
+
+    SealedBucket corrupted = sealed;
+    corrupted.ciphertext[0] ^= 0x01;
+    CHECK(!cipher.open(5, corrupted, opened));
+
+    // A wiped bucket is not an empty one
+    CHECK(!cipher.open(5, SealedBucket(), opened) && opened.empty());
+    CHECK(cipher.open(5, cipher.seal(5, {}), opened) && opened.empty());
+}
+
+TEST(BucketKeysDoNotFollowTheSeed)
+{
+    setGlobalSeed(37);
+    BucketKey first = BucketCipher::generateKey();
+    setGlobalSeed(37);
+    BucketKey second = BucketCipher::generateKey();
+    CHECK(first != second);
+}
@@ -0,0 +1,44 @@
+#include "TestHarness.h"
+#include "ORAMTree.h"
+
+namespace {
+
+// Every node's children point back at it, and every path runs root to leaf through parents
+template <int Arity>
+void checkGeometry(int depth) {
+    using Geometry = TreeGeometry<Arity>;
+    const NodeIndex innerNodes = Geometry::levelStart(depth);
+    for (NodeIndex i = 0; i < innerNodes; ++i) {
+        for (int k = 1; k <= Arity; ++k)
+            CHECK(Geometry::parent(Arity * i + k) == i);
+        CHECK(Geometry::pathId(i, depth) == -1);
+    }
+
+    BasicORAMTree<4, Arity> tree(depth);
+    CHECK(tree.getLeafCount() == Geometry::leafCount(depth));
+    CHECK(tree.getNodeCount() == Geometry::nodeCount(depth));
+    for (LeafId leaf = 0; leaf < Geometry::leafCount(depth); ++leaf) {
+        NodeIndex leafNode = Geometry::leafIndex(leaf, depth);
+        CHECK(Geometry::pathId(leafNode, depth) == leaf);
+
+        std::vector<NodeIndex> path = tree.getPathIndices(leaf);
+        CHECK(static_cast<int>(path.size()) == depth + 1);
+        CHECK(path.front() == 0 && path.back() == leafNode);
+        for (size_t level = 1; level < path.size(); ++level) {
+            CHECK(Geometry::parent(path[level]) == path[level - 1]);
+            CHECK(path[level] >= Geometry::levelStart(static_cast<int>(level)));
+            CHECK(path[level] < Geometry::levelStart(static_cast<int>(level) + 1));
+        }
+    }
+}
+
+} // namespace
+
+TEST(KAryGeometryIsConsistent)
+{
+    checkGeometry<2>(5);
+    checkGeometry<4>(3);
+    checkGeometry<8>(2);
+    CHECK(TreeGeometry<4>::depthForLeaves(17) == 3);
+    CHECK(TreeGeometry<8>::depthForLeaves(64) == 2);
+}
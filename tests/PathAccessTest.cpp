@@ -0,0 +1,154 @@
+#include "TestHarness.h"
+#include "ORAMQuery.h"
+#include "Random.h"
+#include <atomic>
+#include <map>
+#include <thread>
+
+namespace {
+
+struct PathOram {
+    ORAMTree tree;
+    PositionMap positionMap;
+    Stash stash;
+    DRLogSet drl{4};
+
+    PathOram(int depth, size_t stashCapacity) : tree(depth), stash(stashCapacity) {}
+
+    // Blocks start out on random paths, as deep as their path has room for
+    void populate(int numBlocks) {
+        for (int id = 0; id < numBlocks; ++id) {
+            LeafId leaf = randomLeaf(tree.getLeafCount());
+            positionMap.updatePosition(id, leaf);
+            std::vector<NodeIndex> path = tree.getPathIndices(leaf);
+            bool placed = false;
+            for (auto it = path.rbegin(); it != path.rend() && !placed; ++it)
+                placed = tree.addBlock(*it, Block(id, "Block " + std::to_string(id), false));
+            if (!placed)
+                stash.addBlock(Block(id, "Block " + std::to_string(id), false));
+        }
+    }
+
+    // How often each real block ID is held by the tree and the stash together
+    std::map<int, int> blockCounts(size_t& largestBucket) const {
+        std::map<int, int> counts;
+        largestBucket = 0;
+        for (NodeIndex i = 0; i < tree.getNodeCount(); ++i) {
+            std::vector<Block> bucket = tree.getNode(i).bucket;
+            largestBucket = std::max(largestBucket, bucket.size());
+            for (const Block& b : bucket)
+                if (!b.isDummy) ++counts[b.id];
+        }
+        for (const Block& b : stash.getAllBlocks())
+            ++counts[b.id];
+        return counts;
+    }
+};
+
+void checkConcurrentReadsKeepEveryBlock(bool encrypted) {
+    const int kBlocks = 200, kThreads = 8, kReadsPerThread = 300;
+    PathOram oram(6, 0);
+    if (encrypted) {
+        BucketKey key{};
+        key.fill(0x5a);
+        oram.tree.enableEncryption(key);
+    }
+    oram.populate(kBlocks);
+
+    // Thread t reads only blocks t, t + kThreads, ..., so no block is ever remapped under a reader
+    // and every read has to find its block, wherever other threads' accesses are moving it
+    std::atomic<int> missedReads{0};
+    std::vector<std::thread> clients;
+    for (int t = 0; t < kThreads; ++t) {
+        clients.emplace_back([&oram, &missedReads, t]() {
+            QueryLog ownLog(1); // no overlap handling needed, the block sets are disjoint
+            ORAMQuery query(oram.tree, oram.positionMap, oram.stash, oram.drl, ownLog);
+            std::uniform_int_distribution<int> blockDist(0, kBlocks / kThreads - 1);
+            for (int q = 0; q < kReadsPerThread; ++q) {
+                int id = blockDist(randomEngine()) * kThreads + t;
+                if (query.read(id).id != id)
+                    ++missedReads;
+            }
+        });
+    }
+    for (auto& t : clients)
+        t.join();
+    CHECK(missedReads == 0);
+
+    size_t largestBucket = 0;
+    std::map<int, int> counts = oram.blockCounts(largestBucket);
+    CHECK(static_cast<int>(counts.size()) == kBlocks);
+    for (const auto& [id, count] : counts)
+        CHECK(count == 1);
+    CHECK(largestBucket <= static_cast<size_t>(ORAMTree::bucketSize));
+
+    // And every block still reads back with its own data
+    QueryLog log(1); // a round per query, so nothing is served as an overlap
+    ORAMQuery query(oram.tree, oram.positionMap, oram.stash, oram.drl, log);
+    for (int id = 0; id < kBlocks; ++id) {
+        Block b = query.read(id);
+        CHECK(b.id == id && b.data == "Block " + std::to_string(id));
+    }
+}
+
+} // namespace
+
+TEST(ConcurrentReadsNeverLoseABlock)
+{
+    checkConcurrentReadsKeepEveryBlock(false);
+}
+
+TEST(ConcurrentReadsNeverLoseASealedBlock)
+{
+    checkConcurrentReadsKeepEveryBlock(true);
+}
+
+TEST(StashBackpressureKeepsOccupancyBounded)
+{
+    setGlobalSeed(32);
+    const int kDepth = 5, kBlocks = 160;
+    const size_t kCapacity = 2;
+    PathOram oram(kDepth, kCapacity);
+    oram.populate(kBlocks);
+
+    QueryLog log(1);
+    ORAMQuery query(oram.tree, oram.positionMap, oram.stash, oram.drl, log);
+    std::uniform_int_distribution<int> blockDist(0, kBlocks - 1);
+    for (int q = 0; q < 3000; ++q)
+        query.read(blockDist(randomEngine()));
+
+    // Over capacity, queries evict random paths first; at most one path is in flight on top
+    CHECK(oram.stash.getForcedEvictions() > 0);
+    CHECK(oram.stash.getHighWaterMark() <= kCapacity + ORAMTree::bucketSize * (kDepth + 1));
+
+    size_t largestBucket = 0;
+    std::map<int, int> counts = oram.blockCounts(largestBucket);
+    CHECK(static_cast<int>(counts.size()) == kBlocks);
+    CHECK(largestBucket <= static_cast<size_t>(ORAMTree::bucketSize));
+}
+
+TEST(SparsePathAccessesKeepOnlyOccupiedBuckets)
+{
+    ORAMTree tree(40, 0, true);
+    PositionMap positionMap;
+    Stash stash;
+    DRLogSet drl(4);
+    QueryLog log(4);
+    ORAMQuery query(tree, positionMap, stash, drl, log);
+
+    // No blocks at all: dummy reads must not leave buckets behind
+    for (int q = 0; q < 1000; ++q)
+        query.dummyRead();
+    CHECK(tree.getAllocatedBucketCount() == 0);
+
+    // With blocks, at most one bucket per block stays allocated, and every block is still there
+    for (int id = 0; id < 20; ++id) {
+        positionMap.updatePosition(id, randomLeaf(tree.getLeafCount()));
+        stash.addBlock(Block(id, "Block " + std::to_string(id), false));
+    }
+    for (int q = 0; q < 500; ++q) {
+        Block block = query.read(q % 20);
+        CHECK(block.id == q % 20);
+    }
+    CHECK(tree.getAllocatedBucketCount() <= 20);
+}
@@ -0,0 +1,40 @@
+#include "TestHarness.h"
+#include "RingORAM.h"
+#include "Random.h"
+#include <random>
+
+TEST(RingReadsReturnTheLastWriteThroughEvictionsAndReshuffles)
+{
+    const int kDepth = 5, kBlocks = 48, kAccesses = 3000;
+    setGlobalSeed(36);
+    PositionMap positionMap;
+    Stash stash;
+    // An eviction after every access, and a reshuffle after every two reads of a bucket
+    RingORAM ring(kDepth, positionMap, stash, RingPolicy{4, 2, 1});
+    std::uniform_int_distribution<LeafId> leafDist(0, ring.getLeafCount() - 1);
+
+    std::vector<std::string> expected(kBlocks);
+    for (int id = 0; id < kBlocks; ++id) {
+        expected[id] = "Block " + std::to_string(id);
+        ring.writeBlock(id, expected[id], leafDist(randomEngine()));
+    }
+
+    std::mt19937 rng(36);
+    int wrongData = 0, wrongReads = 0;
+    for (int q = 0; q < kAccesses; ++q) {
+        int id = static_cast<int>(rng() % kBlocks);
+        if (q % 10 == 0) {
+            expected[id] = "Block " + std::to_string(id) + " v" + std::to_string(q);
+            ring.writeBlock(id, expected[id], leafDist(randomEngine()));
+            continue;
+        }
+
+        long long readsBefore = ring.getOnlineBlockReads();
+        Block block = ring.access(id);
+        if (ring.getOnlineBlockReads() - readsBefore != kDepth + 1) ++wrongReads; // one slot per bucket
+        if (block.id != id || block.data != expected[id]) ++wrongData;
+    }
+    CHECK(wrongData == 0);
+    CHECK(wrongReads == 0);
+    CHECK(ring.getOfflineBlockTraffic() > 0);
+}
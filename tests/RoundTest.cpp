@@ -0,0 +1,248 @@
+#include "TestHarness.h"
+#include "ORAMQuery.h"
+#include "RoundScheduler.h"
+#include "ConstantRateScheduler.h"
+#include "Serialization.h"
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+TEST(RoundSealsAtCArrivalsWithQueriesRunning)
+{
+    QueryLog log(3);
+    QueryTicket first = log.registerQuery(1);
+    QueryTicket second = log.registerQuery(2);
+    QueryTicket third = log.registerQuery(3);
+    QueryTicket fourth = log.registerQuery(4); // none has finished, still goes to the next round
+
+    CHECK(first.round == 0 && second.round == 0 && third.round == 0);
+    CHECK(third.queryId == 2);
+    CHECK(fourth.round == 1 && fourth.queryId == 0);
+    CHECK(log.getSealedRoundCount() == 1);
+
+    // The sealed round still catches overlaps until its own queries are done
+    CHECK(log.registerQuery(2).overlap);
+    CHECK(log.completeQuery(first) == -1);
+    CHECK(log.completeQuery(second) == -1);
+    CHECK(log.completeQuery(third) == 0); // drained: round 0 is due in the DR-LogSet
+    CHECK(!log.registerQuery(1).overlap);
+    CHECK(log.size() == 3);               // round 1 only
+}
+
+TEST(DeadlineSealsRoundWithQueriesRunning)
+{
+    QueryLog log(10);
+    long long drained = -1;
+    CHECK(!log.sealOpenRound(0, drained)); // nothing registered, nothing to seal
+
+    QueryTicket running = log.registerQuery(7);
+    QueryTicket finished = log.registerQuery(8);
+    CHECK(log.completeQuery(finished) == -1);
+    CHECK(!log.sealOpenRound(60000, drained)); // not old enough yet
+    CHECK(log.sealOpenRound(0, drained));
+    CHECK(drained == -1);                       // query 7 is still running
+
+    CHECK(log.registerQuery(9).round == 1);
+    CHECK(log.completeQuery(running) == 0);
+
+    // A round whose queries are all done drains as it is sealed
+    CHECK(log.sealOpenRound(0, drained));
+    CHECK(drained == -1);                        // query 9 never completed
+    QueryTicket last = log.registerQuery(3);
+    CHECK(log.completeQuery(last) == -1);
+    CHECK(log.sealOpenRound(0, drained));
+    CHECK(drained == 2);
+}
+
+TEST(RoundsKeepClosingUnderLoad)
+{
+    const int kThreads = 8, kReadsPerThread = 200, kBlocksPerThread = 20, kC = 4;
+    ORAMTree tree(6);
+    PositionMap positionMap;
+    Stash stash;
+    DRLogSet drl(kC);
+    QueryLog qlog(kC);
+    for (int id = 0; id < kThreads * kBlocksPerThread; ++id) {
+        stash.addBlock(Block(id, "Block " + std::to_string(id), false));
+        positionMap.updatePosition(id, id % tree.getLeafCount());
+    }
+
+    // Eight clients keep queries in flight at all times; rounds must still seal every c queries
+    std::vector<std::thread> clients;
+    for (int t = 0; t < kThreads; ++t) {
+        clients.emplace_back([&, t]() {
+            ORAMQuery query(tree, positionMap, stash, drl, qlog);
+            for (int q = 0; q < kReadsPerThread; ++q)
+                query.read((q % kBlocksPerThread) * kThreads + t);
+        });
+    }
+    for (auto& t : clients)
+        t.join();
+
+    const int total = kThreads * kReadsPerThread;
+    CHECK(qlog.getSealedRoundCount() == total / kC);
+    CHECK(qlog.size() == 0);    // every sealed round drained and left the log
+    CHECK(qlog.getInFlight() == 0);
+    CHECK(drl.getFinalizedRoundCount() == static_cast<size_t>(total / kC)); // one DRL round per QueryLog round
+}
+
+TEST(SchedulerSealsPartialRoundAtDeadline)
+{
+    DRLogSet drl(8);
+    StashSet stashSet(8);
+    QueryLog qlog(8);
+    RoundScheduler scheduler(drl, stashSet, qlog, RoundPolicy{8, 8, 50, 20});
+
+    ORAMTree tree(3);
+    PositionMap positionMap;
+    Stash stash;
+    ORAMQuery query(tree, positionMap, stash, drl, qlog);
+    scheduler.recordArrival();
+    query.read(1); // a lone query, far from c
+    scheduler.recordCompletion(1);
+
+    for (int i = 0; i < 100 && drl.getFinalizedRoundCount() == 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(qlog.getSealedRoundCount() == 1);
+    CHECK(drl.getFinalizedRoundCount() == 1);
+    CHECK(qlog.size() == 0);
+}
+
+TEST(RoundIsPaddedWithTheCItWasOpenedUnder)
+{
+    QueryLog qlog(2);
+    DRLogSet drl(2);
+    QueryTicket first = qlog.registerQuery(1);
+    drl.appendToCurrent(Block(1, "Block 1", false), first.round);
+
+    // c changes while round 0 is open: only the next round takes it
+    long long fromRound = qlog.setRoundSize(5);
+    CHECK(fromRound == 1);
+    drl.setRoundSize(5, fromRound);
+    CHECK(drl.getRoundSize() == 5);
+
+    QueryTicket second = qlog.registerQuery(2); // seals round 0 at its old c = 2
+    drl.appendToCurrent(Block(2, "Block 2", false), second.round);
+    CHECK(qlog.completeQuery(first) == -1);
+    CHECK(qlog.completeQuery(second) == 0);
+    drl.finalizeRound(0);
+
+    QueryTicket third = qlog.registerQuery(3);
+    CHECK(third.round == 1);
+    drl.appendToCurrent(Block(3, "Block 3", false), third.round);
+    long long drained = -1;
+    CHECK(qlog.sealOpenRound(0, drained) && drained == -1);
+    CHECK(qlog.completeQuery(third) == 1);
+    drl.finalizeRound(1);
+
+    std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+    drl.serialize(out);
+    int32_t c = 0;
+    std::vector<Block> current, log;
+    uint64_t logCount = 0, indexSize = 0;
+    CHECK(readPod(out, c) && c == 5);
+    CHECK(readBlocks(out, current) && current.empty());
+    CHECK(readPod(out, logCount) && logCount == 2);
+    CHECK(readBlocks(out, log) && log.size() == 2 + 2); // two reads, two dummies
+    CHECK(readPod(out, indexSize) && indexSize == 2);
+    for (uint64_t i = 0; i < indexSize; ++i) {
+        int32_t id = 0;
+        readPod(out, id);
+    }
+    CHECK(readBlocks(out, log) && log.size() == 1 + 5); // one read, five dummies
+}
+
+TEST(OverlapWaitsOnlyForTheEarlierQuery)
+{
+    QueryLog log(4);
+    QueryTicket first = log.registerQuery(5);
+    log.registerQuery(6);
+    QueryTicket second = log.registerQuery(5);
+    CHECK(second.overlap && second.overlapRound == 0 && second.overlapQueryId == 0);
+
+    std::atomic<bool> released{false};
+    std::thread waiter([&]() {
+        log.waitForOverlapped(second);
+        released = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!released);
+    log.completeQuery(first);
+    waiter.join();
+    CHECK(released);
+
+    // Once the earlier query is done, a serial client never waits at all
+    ORAMTree tree(4);
+    PositionMap positionMap;
+    Stash stash;
+    DRLogSet drl(8);
+    QueryLog qlog(8);
+    stash.addBlock(Block(1, "Block 1", false));
+    positionMap.updatePosition(1, 0);
+    ORAMQuery query(tree, positionMap, stash, drl, qlog);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int q = 0; q < 40; ++q)
+        query.read(1);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+}
+
+TEST(PaddingQueriesTakeARoundSlotLikeReads)
+{
+    ORAMTree tree(4);
+    PositionMap positionMap;
+    Stash stash;
+    DRLogSet drl(2);
+    QueryLog qlog(2);
+    ORAMQuery query(tree, positionMap, stash, drl, qlog);
+
+    CHECK(!qlog.registerQuery(QueryLog::kPaddingBlockId).overlap);
+    CHECK(!qlog.registerQuery(QueryLog::kPaddingBlockId).overlap); // never overlaps another padding
+    long long drained = -1;
+    CHECK(!qlog.sealOpenRound(0, drained)); // sealed at c = 2 already
+
+    // Two padding queries fill and drain a round of their own, through the DR-LogSet as reads do
+    QueryLog paddedLog(2);
+    ORAMQuery padded(tree, positionMap, stash, drl, paddedLog);
+    padded.dummyRead();
+    padded.dummyRead();
+    CHECK(paddedLog.getSealedRoundCount() == 1);
+    CHECK(paddedLog.size() == 0);
+    CHECK(drl.getFinalizedRoundCount() == 1);
+}
+
+TEST(ConstantRateSchedulerOwnsRoundBoundaries)
+{
+    ORAMTree tree(5);
+    PositionMap positionMap;
+    Stash stash;
+    DRLogSet drl(2);
+    QueryLog qlog(2);
+    for (int id = 0; id < 8; ++id) {
+        stash.addBlock(Block(id, "Block " + std::to_string(id), false));
+        positionMap.updatePosition(id, id % tree.getLeafCount());
+    }
+    ORAMQuery(tree, positionMap, stash, drl, qlog).read(7); // a half-filled round from before
+
+    {
+        ConstantRateScheduler crs(tree, positionMap, stash, drl, qlog, ConstantRatePolicy{200, 4});
+        CHECK(qlog.getRoundSize() == 4);
+        CHECK(qlog.getSealedRoundCount() >= 1); // the stray round was closed first
+
+        std::vector<std::future<Block>> results;
+        for (int id = 0; id < 8; ++id)
+            results.push_back(crs.submit(id));
+        for (int id = 0; id < 8; ++id) {
+            Block block = results[id].get();
+            CHECK(block.id == id && block.data == "Block " + std::to_string(id));
+        }
+    }
+
+    // Every tick was one full round, drained and finalized, and the old c is back
+    CHECK(qlog.getRoundSize() == 2);
+    CHECK(drl.getRoundSize() == 2);
+    CHECK(qlog.size() == 0);
+    CHECK(qlog.getSealedRoundCount() >= 3);
+    CHECK(static_cast<long long>(drl.getFinalizedRoundCount()) == qlog.getSealedRoundCount());
+}
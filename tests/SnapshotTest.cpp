@@ -0,0 +1,237 @@
+#include "TestHarness.h"
+#include "ORAMQuery.h"
+#include "Serialization.h"
+#include "Snapshot.h"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// Everything a snapshot covers, built the way main() builds it
+struct OramState {
+    ORAMTree tree;
+    PositionMap positionMap;
+    Stash stash;
+    StashSet stashSet{4};
+    DRLogSet drl{4};
+    QueryLog qlog{4};
+
+    explicit OramState(int depth) : tree(depth) {}
+
+    void populate(int numBlocks) {
+        for (int id = 0; id < numBlocks; ++id) {
+            LeafId leaf = id % tree.getLeafCount();
+            tree.addBlock(ORAMTree::Geometry::leafIndex(leaf, tree.getDepth()), Block(id, "Block " + std::to_string(id), false));
+            positionMap.updatePosition(id, leaf);
+        }
+    }
+
+    bool save(const std::string& path) const {
+        return saveSnapshot(path, tree, positionMap, stash, stashSet, drl, qlog);
+    }
+
+    bool restore(const std::string& path) {
+        return restoreSnapshot(path, tree, positionMap, stash, stashSet, drl, qlog);
+    }
+
+    // How often each real block ID is held by the tree and the stash together
+    std::map<int, int> blockCounts() const {
+        std::map<int, int> counts;
+        for (NodeIndex i = 0; i < tree.getNodeCount(); ++i)
+            for (const Block& b : tree.getNode(i).bucket)
+                if (!b.isDummy) ++counts[b.id];
+        for (const Block& b : stash.getAllBlocks())
+            ++counts[b.id];
+        return counts;
+    }
+};
+
+template <typename T>
+std::string bytesOf(const T& structure) {
+    std::ostringstream out(std::ios::binary);
+    structure.serialize(out);
+    return out.str();
+}
+
+std::string snapshotPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("concuroram_" + name + ".snap")).string();
+}
+
+void checkRoundTrip(bool encrypted) {
+    OramState original(4);
+    OramState restored(4);
+    if (encrypted) {
+        BucketKey first{}, second{};
+        first.fill(0x11);
+        second.fill(0x22); // the restoring tree re-seals under its own key
+        original.tree.enableEncryption(first);
+        restored.tree.enableEncryption(second);
+    }
+
+    original.populate(20);
+    ORAMQuery query(original.tree, original.positionMap, original.stash, original.drl, original.qlog);
+    for (int id = 0; id < 10; ++id)
+        query.read(id);
+
+    std::string path = snapshotPath(encrypted ? "roundtrip_sealed" : "roundtrip");
+    CHECK(original.save(path));
+    CHECK(restored.restore(path));
+
+    CHECK(bytesOf(restored.tree) == bytesOf(original.tree));
+    CHECK(bytesOf(restored.positionMap) == bytesOf(original.positionMap));
+    CHECK(bytesOf(restored.stash) == bytesOf(original.stash));
+    CHECK(bytesOf(restored.stashSet) == bytesOf(original.stashSet));
+    CHECK(bytesOf(restored.drl) == bytesOf(original.drl));
+    CHECK(bytesOf(restored.qlog) == bytesOf(original.qlog));
+    std::filesystem::remove(path);
+}
+
+} // namespace
+
+TEST(SnapshotRoundTripRestoresEveryStructure)
+{
+    checkRoundTrip(false);
+}
+
+TEST(SnapshotRoundTripOfSealedBuckets)
+{
+    checkRoundTrip(true);
+}
+
+TEST(SnapshotTakenDuringQueriesIsConsistent)
+{
+    const int kThreads = 4, kBlocksPerThread = 50;
+    OramState state(6);
+    state.populate(kThreads * kBlocksPerThread);
+
+    std::vector<std::thread> clients;
+    for (int t = 0; t < kThreads; ++t) {
+        clients.emplace_back([&state, t]() {
+            ORAMQuery query(state.tree, state.positionMap, state.stash, state.drl, state.qlog);
+            for (int i = 0; i < kBlocksPerThread; ++i)
+                query.read(t * kBlocksPerThread + i); // every block once, so no overlapping queries
+        });
+    }
+
+    // Every snapshot must hold each block exactly once, however the queries were interleaved
+    std::string path = snapshotPath("concurrent");
+    for (int s = 0; s < 10; ++s) {
+        CHECK(state.save(path));
+        OramState copy(6);
+        CHECK(copy.restore(path));
+        std::map<int, int> counts = copy.blockCounts();
+        CHECK(static_cast<int>(counts.size()) == kThreads * kBlocksPerThread);
+        for (const auto& [id, count] : counts)
+            CHECK(count == 1);
+    }
+    for (auto& t : clients)
+        t.join();
+    std::filesystem::remove(path);
+}
+
+TEST(RestoreRejectsInvalidTreeGeometry)
+{
+    auto treeSection = [](int32_t depth, uint8_t sparse, std::vector<int64_t> indices) {
+        std::ostringstream out(std::ios::binary);
+        writePod(out, depth);
+        writePod(out, sparse);
+        writePod(out, static_cast<uint64_t>(indices.size()));
+        for (int64_t index : indices) {
+            writePod(out, index);
+            writeBlocks(out, {Block(7, "x", false)});
+        }
+        return out.str();
+    };
+    auto accepts = [](const std::string& bytes) {
+        ORAMTree tree(3);
+        std::istringstream in(bytes, std::ios::binary);
+        return tree.deserialize(in, kSnapshotVersion);
+    };
+
+    CHECK(accepts(treeSection(3, 0, {0, 14})));
+    CHECK(!accepts(treeSection(70, 1, {0})));                 // deeper than 64-bit indices allow
+    CHECK(!accepts(treeSection(kMaxDenseDepth + 1, 0, {0}))); // too deep to allocate densely
+    CHECK(!accepts(treeSection(-1, 0, {})));
+    CHECK(!accepts(treeSection(3, 0, {15})));                 // a depth-3 tree has nodes 0 to 14
+    CHECK(!accepts(treeSection(3, 0, {-4})));
+    CHECK(!accepts(treeSection(3, 0, {2, 2})));
+}
+
+TEST(FailedRestoreLeavesStateUntouched)
+{
+    OramState small(3);
+    small.populate(6);
+    std::string path = snapshotPath("truncated");
+    CHECK(small.save(path));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3); // cut into the last section
+
+    OramState live(5);
+    live.populate(12);
+    std::string treeBefore = bytesOf(live.tree);
+    std::string mapBefore = bytesOf(live.positionMap);
+    CHECK(!live.restore(path));
+    CHECK(live.tree.getDepth() == 5);
+    CHECK(bytesOf(live.tree) == treeBefore);
+    CHECK(bytesOf(live.positionMap) == mapBefore);
+    std::filesystem::remove(path);
+}
+
+TEST(CraftedStringLengthIsRejected)
+{
+    std::ostringstream out(std::ios::binary);
+    writePod(out, static_cast<uint64_t>(1) << 62);
+    out << "short";
+
+    std::istringstream in(out.str(), std::ios::binary);
+    std::string s;
+    CHECK(!readString(in, s)); // would throw length_error if the length were trusted
+    CHECK(s.empty());
+}
+
+TEST(RestoreReadsVersionOneSnapshots)
+{
+    // v1: dense tree with 32-bit node indices, 32-bit leaf IDs in the position map
+    std::ostringstream out(std::ios::binary);
+    out.write("CORAMSNP", 8);
+    writePod(out, static_cast<uint32_t>(1));
+    writePod(out, static_cast<int32_t>(3));
+    writePod(out, static_cast<uint64_t>(1));
+    writePod(out, static_cast<int32_t>(9)); // leaf 2 of a depth-3 tree
+    writeBlocks(out, {Block(5, "five", false)});
+    writePod(out, static_cast<uint64_t>(1));
+    writePod(out, static_cast<int32_t>(5));
+    writePod(out, static_cast<int32_t>(2));
+
+    OramState empty(3); // the remaining sections did not change in v2
+    empty.stash.serialize(out);
+    empty.stashSet.serialize(out);
+    empty.drl.serialize(out);
+    empty.qlog.serialize(out);
+
+    std::string path = snapshotPath("v1");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << out.str();
+    }
+
+    OramState restored(5);
+    CHECK(restored.restore(path));
+    CHECK(restored.tree.getDepth() == 3);
+    CHECK(!restored.tree.isSparse());
+    CHECK(restored.positionMap.getPosition(5) == 2);
+    std::vector<Block> bucket = restored.tree.getNode(9).bucket;
+    CHECK(bucket.size() == 1 && bucket[0].id == 5 && bucket[0].data == "five");
+    std::filesystem::remove(path);
+}
+
+TEST(SparseTreetopIsCapped)
+{
+    ORAMTree sparse(40, 30, true);
+    CHECK(sparse.getTreetopLevels() == kMaxSparseTreetopLevels);
+
+    ORAMTree dense(4, 5);
+    CHECK(dense.getTreetopLevels() == 5);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <vector>
+
+// Minimal self-registering test cases; `make test` builds every tests/*.cpp against the
+// library sources (everything except main.cpp) and runs them all
+
+struct TestCase {
+    const char* name;
+    std::function<void()> run;
+};
+
+std::vector<TestCase>& testRegistry();
+int& testFailures();
+
+#define TEST(name)                                                                        \
+    static void name();                                                                   \
+    static const bool name##Registered = (testRegistry().push_back({#name, name}), true); \
+    static void name()
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition "\n"; \
+            ++testFailures();                                                             \
+        }                                                                                 \
+    } while (0)
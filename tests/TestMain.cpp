@@ -0,0 +1,30 @@
+#include "TestHarness.h"
+
+std::vector<TestCase>& testRegistry()
+{
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+int& testFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+int main()
+{
+    int failedCases = 0;
+    for (const TestCase& test : testRegistry())
+    {
+        int before = testFailures();
+        test.run();
+        bool passed = (testFailures() == before);
+        if (!passed)
+            ++failedCases;
+        std::cerr << (passed ? "[ PASS ] " : "[ FAIL ] ") << test.name << "\n";
+    }
+
+    std::cerr << testRegistry().size() - failedCases << " of " << testRegistry().size() << " tests passed\n";
+    return failedCases == 0 ? 0 : 1;
+}